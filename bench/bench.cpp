@@ -0,0 +1,322 @@
+#include<cstdlib>
+#include<fstream>
+#include<random>
+#include<sstream>
+#include<string>
+#include<utility>
+#include<vector>
+#include<benchmark/benchmark.h>
+#include"json.h"
+#ifdef LEPTJSON_BENCH_NLOHMANN
+#include<nlohmann/json.hpp>
+#endif
+
+using namespace LeptJson;
+
+namespace
+{
+//一份测试语料：名字和原文
+struct Corpus
+{
+    std::string name;
+    std::string content;
+};
+
+//大量浮点数，类似canada.json的坐标数组
+std::string makeNumbers(size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-180.0, 180.0);
+    std::ostringstream os;
+    os.precision(17);
+    os << "[";
+    for(size_t i = 0; i < count; i++)
+        os << (i ? "," : "") << "[" << dist(gen) << "," << dist(gen) << "]";
+    os << "]";
+    return os.str();
+}
+
+//大量字符串，含少量需要转义的字符和非ASCII字符
+std::string makeStrings(size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> len(4, 64);
+    std::uniform_int_distribution<int> ch('a', 'z');
+    std::string res = "[";
+    for(size_t i = 0; i < count; i++)
+    {
+        if(i)
+            res += ',';
+        res += '"';
+        int n = len(gen);
+        for(int j = 0; j < n; j++)
+            res += static_cast<char>(ch(gen));
+        if(i % 8 == 0)
+            res += "\\n\\\"\xE4\xB8\xAD";
+        res += '"';
+    }
+    res += "]";
+    return res;
+}
+
+//对象数组，类似twitter.json/citm_catalog.json的记录
+std::string makeRecords(size_t count)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> num(0, 1000000);
+    std::ostringstream os;
+    os << "[";
+    for(size_t i = 0; i < count; i++)
+    {
+        os << (i ? "," : "") << "{\"id\":" << num(gen)
+           << ",\"name\":\"user" << num(gen) << "\""
+           << ",\"verified\":" << (i % 3 ? "false" : "true")
+           << ",\"score\":" << num(gen) / 1000.0
+           << ",\"tags\":[\"a\",\"b\",\"c\"]"
+           << ",\"profile\":{\"lang\":\"en\",\"followers\":" << num(gen)
+           << ",\"location\":null}}";
+    }
+    os << "]";
+    return os.str();
+}
+
+//环境变量LEPTJSON_BENCH_DATA或源码目录bench/data下的标准语料，存在才加载
+std::vector<Corpus> loadCorpora()
+{
+    std::vector<Corpus> corpora = {
+        {"numbers", makeNumbers(50000)},
+        {"strings", makeStrings(50000)},
+        {"records", makeRecords(10000)},
+    };
+    const char* env = std::getenv("LEPTJSON_BENCH_DATA");
+    std::string dir = env ? env : LEPTJSON_BENCH_DATA_DIR;
+    for(const char* name : {"twitter.json", "canada.json", "citm_catalog.json"})
+    {
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        if(!in)
+            continue;
+        std::ostringstream os;
+        os << in.rdbuf();
+        corpora.push_back({name, os.str()});
+    }
+    return corpora;
+}
+
+Json parseOrDie(const std::string& content)
+{
+    std::string errMsg;
+    Json json = Json::parse(content, errMsg);
+    if(!errMsg.empty())
+    {
+        fprintf(stderr, "bench: parse failed: %s\n", errMsg.substr(0, 80).c_str());
+        std::exit(1);
+    }
+    return json;
+}
+
+void BM_Parse(benchmark::State& state, const Corpus* corpus)
+{
+    for(auto _ : state)
+    {
+        std::string errMsg;
+        Json json = Json::parse(corpus->content, errMsg);
+        benchmark::DoNotOptimize(json);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+//解析后原样转发，数字保留原文，不做任何转换
+void BM_ForwardRaw(benchmark::State& state, const Corpus* corpus)
+{
+    ParseOptions options;
+    options.rawNumbers = true;
+    for(auto _ : state)
+    {
+        std::string errMsg;
+        Json json = Json::parse(corpus->content, errMsg, options);
+        std::string out = json.serialize();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+//对照组，数字解析成double再格式化
+void BM_Forward(benchmark::State& state, const Corpus* corpus)
+{
+    for(auto _ : state)
+    {
+        std::string errMsg;
+        Json json = Json::parse(corpus->content, errMsg);
+        std::string out = json.serialize();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+//同一个文档反复解析，重用上一次的节点和缓冲区
+void BM_ParseInto(benchmark::State& state, const Corpus* corpus)
+{
+    Json json;
+    std::string errMsg;
+    for(auto _ : state)
+    {
+        Json::parseInto(json, corpus->content, errMsg);
+        benchmark::DoNotOptimize(json);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+//数字数组存成紧凑数组
+void BM_ParsePacked(benchmark::State& state, const Corpus* corpus)
+{
+    ParseOptions options;
+    options.packNumbers = true;
+    for(auto _ : state)
+    {
+        std::string errMsg;
+        Json json = Json::parse(corpus->content, errMsg, options);
+        benchmark::DoNotOptimize(json);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+void BM_Serialize(benchmark::State& state, const Corpus* corpus)
+{
+    Json json = parseOrDie(corpus->content);
+    size_t bytes = 0;
+    for(auto _ : state)
+    {
+        std::string res = json.serialize();
+        bytes += res.size();
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+//每次只改一个元素，其余的子树拼接缓存
+void BM_SerializeCached(benchmark::State& state, const Corpus* corpus)
+{
+    Json json = parseOrDie(corpus->content);
+    if(!json.isArray() || json.size() == 0)
+    {
+        state.SkipWithError("root is not a non-empty array");
+        return;
+    }
+    SerializeOptions options;
+    options.cacheFragments = true;
+    size_t bytes = 0;
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        size_t k = i++ % json.size();
+        json[k] = Json(static_cast<double>(k));
+        std::string res = json.serialize(options);
+        bytes += res.size();
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+//拷贝后修改根节点，测量拷贝加上一层写时复制的代价
+void BM_Copy(benchmark::State& state, const Corpus* corpus)
+{
+    Json json = parseOrDie(corpus->content);
+    std::string key = json.isObject() ? json.toObject().begin()->first : "";
+    for(auto _ : state)
+    {
+        Json copy = json;
+        if(json.isArray())
+            copy[size_t(0)] = Json(nullptr);
+        else
+            copy[key] = Json(nullptr);
+        benchmark::DoNotOptimize(copy);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+//只计析构的时间
+void BM_Destroy(benchmark::State& state, const Corpus* corpus)
+{
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        Json* json = new Json(parseOrDie(corpus->content));
+        state.ResumeTiming();
+        delete json;
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+//宽对象上的key查找
+void BM_Lookup(benchmark::State& state)
+{
+    Json::_object obj;
+    std::vector<std::string> keys;
+    for(int i = 0; i < 1000; i++)
+    {
+        keys.push_back("key_" + std::to_string(i));
+        obj[keys.back()] = Json(i);
+    }
+    const Json json(std::move(obj));
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(json[keys[i++ % keys.size()]]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Lookup);
+
+#ifdef LEPTJSON_BENCH_NLOHMANN
+void BM_NlohmannParse(benchmark::State& state, const Corpus* corpus)
+{
+    for(auto _ : state)
+    {
+        auto json = nlohmann::json::parse(corpus->content);
+        benchmark::DoNotOptimize(json);
+    }
+    state.SetBytesProcessed(state.iterations() * corpus->content.size());
+}
+
+void BM_NlohmannSerialize(benchmark::State& state, const Corpus* corpus)
+{
+    auto json = nlohmann::json::parse(corpus->content);
+    size_t bytes = 0;
+    for(auto _ : state)
+    {
+        std::string res = json.dump();
+        bytes += res.size();
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetBytesProcessed(bytes);
+}
+#endif
+}//namespace
+
+//语料在运行时才知道，手动注册每个语料上的基准
+int main(int argc, char** argv)
+{
+    static const std::vector<Corpus> corpora = loadCorpora();
+    for(auto& corpus : corpora)
+    {
+        benchmark::RegisterBenchmark(("Parse/" + corpus.name).c_str(), BM_Parse, &corpus);
+        benchmark::RegisterBenchmark(("ParseInto/" + corpus.name).c_str(), BM_ParseInto, &corpus);
+        benchmark::RegisterBenchmark(("Forward/" + corpus.name).c_str(), BM_Forward, &corpus);
+        benchmark::RegisterBenchmark(("ForwardRaw/" + corpus.name).c_str(), BM_ForwardRaw, &corpus);
+        benchmark::RegisterBenchmark(("ParsePacked/" + corpus.name).c_str(), BM_ParsePacked, &corpus);
+        benchmark::RegisterBenchmark(("Serialize/" + corpus.name).c_str(), BM_Serialize, &corpus);
+        benchmark::RegisterBenchmark(("SerializeCached/" + corpus.name).c_str(), BM_SerializeCached, &corpus);
+        benchmark::RegisterBenchmark(("Copy/" + corpus.name).c_str(), BM_Copy, &corpus);
+        benchmark::RegisterBenchmark(("Destroy/" + corpus.name).c_str(), BM_Destroy, &corpus);
+#ifdef LEPTJSON_BENCH_NLOHMANN
+        benchmark::RegisterBenchmark(("NlohmannParse/" + corpus.name).c_str(), BM_NlohmannParse, &corpus);
+        benchmark::RegisterBenchmark(("NlohmannSerialize/" + corpus.name).c_str(), BM_NlohmannSerialize, &corpus);
+#endif
+    }
+    benchmark::Initialize(&argc, argv);
+    if(benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
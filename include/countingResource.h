@@ -0,0 +1,38 @@
+#pragma once
+
+#include<atomic>
+#include<memory_resource>
+
+namespace LeptJson
+{
+//统计分配次数和字节数的memory_resource，实际分配转发给上游
+//传给ParseOptions::resource或Json的构造函数，观察文档真正的分配情况
+//计数是原子的，上游线程安全时它也线程安全
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : _upstream(upstream){}
+
+public:
+    //统计接口
+    size_t allocations() const noexcept {return _allocations.load(std::memory_order_relaxed);}
+    size_t deallocations() const noexcept {return _deallocations.load(std::memory_order_relaxed);}
+    size_t bytesInUse() const noexcept {return _bytesInUse.load(std::memory_order_relaxed);}
+    size_t peakBytes() const noexcept {return _peakBytes.load(std::memory_order_relaxed);}
+    size_t totalBytes() const noexcept {return _totalBytes.load(std::memory_order_relaxed);}
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    std::pmr::memory_resource* _upstream;
+    std::atomic<size_t> _allocations{0};
+    std::atomic<size_t> _deallocations{0};
+    std::atomic<size_t> _bytesInUse{0};
+    std::atomic<size_t> _peakBytes{0};
+    std::atomic<size_t> _totalBytes{0};
+};
+}//namespace LeptJson
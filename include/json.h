@@ -1,21 +1,132 @@
 #pragma once
 
+#include<cstdint>
+#include<iosfwd>
 #include<memory>
+#include<memory_resource>
 #include<string>
 #include<unordered_map>
+#include<utility>
 #include<vector>
 
 namespace LeptJson
 {
 enum class JsonType {kNull, kBool, kNumber, kString, kArray, kObject};
 class JsonValue;
+class JsonWriter;
 
+//解析过程的统计，需要在编译时定义LEPTJSON_PARSE_STATS才会填充
+//未定义时统计代码完全不参与编译，结构体保持全零
+struct ParseStats
+{
+    //各类token的数量
+    size_t nulls = 0;
+    size_t bools = 0;
+    size_t numbers = 0;
+    size_t strings = 0;
+    size_t keys = 0;
+    size_t arrays = 0;
+    size_t objects = 0;
+    //各阶段消耗的输入字节数，字符串包括key和两侧的引号
+    size_t whitespaceBytes = 0;
+    size_t literalBytes = 0;
+    size_t numberBytes = 0;
+    size_t stringBytes = 0;
+    //容器的最大嵌套深度
+    size_t maxDepth = 0;
+    //各阶段的耗时，x86上为时间戳计数器的周期数，其他平台为纳秒
+    //total减去各阶段之和即为构造容器和分派的开销
+    uint64_t whitespaceCycles = 0;
+    uint64_t literalCycles = 0;
+    uint64_t numberCycles = 0;
+    uint64_t stringCycles = 0;
+    uint64_t totalCycles = 0;
+};
+
+//默认的容器最大嵌套深度
+constexpr size_t kDefaultMaxDepth = 1000;
+
+//解析选项
+struct ParseOptions
+{
+    //字段投影，只构造这些路径上的值，路径用.分隔，如"user.name"
+    //路径经过数组时作用于每个元素，选中对象后其整个子树都会保留
+    //未选中的值只做引号和括号匹配后跳过，为空时构造全部
+    std::vector<std::string> fields;
+    //节点和容器从该resource分配，为空时使用默认的堆
+    //resource必须比解析出的文档以及共享其节点的所有拷贝活得更久
+    //拷贝后修改时复制出来的容器和节点也在该resource上，新赋进去的值按它自己构造时的resource分配
+    std::pmr::memory_resource* resource = nullptr;
+    //非空时在解析过程中累加统计，见ParseStats
+    ParseStats* stats = nullptr;
+    //数组和对象的最大嵌套深度，超过时报NESTING TOO DEEP
+    size_t maxDepth = kDefaultMaxDepth;
+    //严格校验字符串和key的UTF-8编码，非法时报INVALID UTF8
+    //同时拒绝\u转义出的孤立低代理项，被字段投影跳过的值不校验
+    bool strictUtf8 = false;
+    //元素全是数字的数组存成紧凑的double或int64_t缓冲区，不为每个元素创建节点
+    //按Json元素访问时才构造一次元素，修改时展开成普通数组，见Json::packedDoubles()
+    bool packNumbers = false;
+    //数字只校验语法并保存原文，toNumber()等取值时才转换，序列化时原样输出
+    //适合只转发、很少读取数字的场景，大整数和高精度小数可以原样保留，见Json::rawNumber()
+    //打开时packNumbers不生效
+    bool rawNumbers = false;
+};
+
+//连续内存的只读视图，C++17还没有std::span
+template<class T>
+struct Span
+{
+    const T* data = nullptr;
+    size_t size = 0;
+
+    const T* begin() const noexcept {return data;}
+    const T* end() const noexcept {return data + size;}
+    const T& operator[](size_t i) const noexcept {return data[i];}
+    bool empty() const noexcept {return size == 0;}
+};
+
+//序列化选项
+struct SerializeOptions
+{
+    //非ASCII字符转义成\uXXXX，输出纯ASCII，非法的UTF-8字节输出为\uFFFD
+    bool escapeUnicode = false;
+    //把/转义成\/，嵌入HTML的<script>时不会出现</
+    bool escapeSlash = false;
+    //容器节点缓存自己的序列化结果，之后没有修改过的子树直接拼接缓存，只重新格式化修改过的路径
+    //修改经过的节点由detach()清除缓存，交出过子节点可变引用的容器不缓存，通过保留的引用修改也不会拼接到旧的结果
+    //缓存的总大小约为文档序列化长度乘以嵌套深度，较小的容器不缓存，写到JsonWriter时只使用不生成
+    bool cacheFragments = false;
+};
+
+//文档的内存占用统计，字节数按容量估算，被共享的节点只计一次
+struct MemoryUsage
+{
+    size_t nodes = 0;           //节点总数
+    size_t strings = 0;         //字符串节点数
+    size_t arrays = 0;          //数组节点数
+    size_t objects = 0;         //对象节点数
+    size_t nodeBytes = 0;       //节点本身及引用计数控制块
+    size_t stringBytes = 0;     //字符串值、key和数字原文在堆上占用的字节
+    size_t containerBytes = 0;  //vector的容量以及哈希表的桶和链表节点
+    size_t fragmentBytes = 0;   //cacheFragments缓存的序列化结果
+
+    size_t totalBytes() const noexcept {return nodeBytes + stringBytes + containerBytes + fragmentBytes;}
+};
+
+//线程安全约定：
+//1. const成员函数不修改任何共享状态，多个线程可以无锁地同时读同一个Json
+//2. 非const成员函数需要独占调用它的那个Json对象
+//3. 不同线程各自持有的拷贝可以分别修改，写时复制保证互不影响
+//4. 对非const的Json调用[]、set()或emplace_back()后，这个节点永久不再共享，拷贝时立即复制，
+//   哈希和序列化缓存也不再保存在它上面。只读取时用at()或者通过const引用访问，拷贝仍然是O(1)
+//需要在线程间共享的只读文档用std::shared_ptr<const Json>传递，见ParseCache
 class Json final
 {
 public:
-    //数组和对象类型
-    using _array = std::vector<Json>;
-    using _object = std::unordered_map<std::string, Json>;
+    //数组和对象类型，使用多态分配器，可以指定memory_resource
+    using _array = std::pmr::vector<Json>;
+    using _object = std::pmr::unordered_map<std::string, Json>;
 
 public:
     //对json几种类型的构造
@@ -36,6 +147,19 @@ public:
     //防止指针意外转换
     Json(void*) = delete;
 
+public:
+    //在指定的memory_resource上分配节点，数组和对象的容器也使用该resource
+    //resource为空时与上面的构造函数相同
+    //字符串的内容和对象的key仍是std::string，超出SSO的部分在默认的堆上
+    Json(std::nullptr_t, std::pmr::memory_resource*);
+    Json(bool, std::pmr::memory_resource*);
+    Json(int val, std::pmr::memory_resource* resource) : Json(1.0 * val, resource) {}
+    Json(double, std::pmr::memory_resource*);
+    Json(const char* cstr, std::pmr::memory_resource* resource) : Json(std::string(cstr), resource) {}
+    Json(std::string, std::pmr::memory_resource*);
+    Json(_array, std::pmr::memory_resource*);
+    Json(_object, std::pmr::memory_resource*);
+
 public:
     //对象的隐式构造
     template<class M, typename std::enable_if<
@@ -54,12 +178,16 @@ public:
                 int>::type = 0>
     Json(const V& v) : Json(_array(v.begin(), v.end())) {} 
 
+public:
+    //紧凑的数值数组，值都是不超过2^53的整数时存成int64_t，否则存成double
+    static Json fromNumbers(std::pmr::vector<double> values, std::pmr::memory_resource* resource = nullptr);
+
 public:
     //析构函数
     ~Json();
 
 public:
-    //拷贝和赋值构造函数
+    //拷贝和赋值构造函数，只增加引用计数，与原对象共享同一棵子树
     Json(const Json&);
     Json& operator=(const Json&) noexcept;
 
@@ -71,7 +199,21 @@ public:
 public:
     //序列化和反序列化
     static Json parse(const std::string& content, std::string& errMsg) noexcept;
+    static Json parse(const std::string& content, std::string& errMsg, const ParseOptions& options) noexcept;
+    //解析到target里，target原来的节点没有被其他Json共享时回收使用，容器和字符串保留容量
+    //形状相近的消息反复解析时几乎不用分配内存，失败时target为null并设置errMsg
+    //options.resource不为空时不回收，target里不能混有用resource构造的节点
+    //之前从target取得的引用全部失效，回收的节点不再带有交出过引用的标记
+    static bool parseInto(Json& target, const std::string& content, std::string& errMsg,
+                          const ParseOptions& options = ParseOptions()) noexcept;
     std::string serialize() const noexcept;
+    std::string serialize(const SerializeOptions& options) const noexcept;
+
+public:
+    //序列化用的工具函数，结果追加到out，供其他序列化器复用
+    static void escapeString(const std::string& str, std::string& out,
+                             const SerializeOptions& options = SerializeOptions()) noexcept;
+    static void formatNumber(double val, std::string& out) noexcept;
 
 public:
     //类型接口
@@ -86,42 +228,127 @@ public:
 public:
     //把json类型转化为值
     bool toBool() const;
+    //rawNumbers解析出的数字在这里才转换，超出double范围时为inf
     double toNumber() const;
+    //整数读成int64_t，原文是整数时不经过double，不会丢失2^53以上的精度
+    //不是整数或超出int64_t范围时抛出异常
+    int64_t toInt64() const;
+    //数字的原文，只有rawNumbers解析出的数字才有，其他情况返回nullptr
+    const std::string* rawNumber() const noexcept;
     const std::string& toString() const;
     const _array& toArray() const;
     const _object& toObject() const;
 
+public:
+    //紧凑数值数组的接口，不是对应类型的紧凑数组时返回空视图
+    //紧凑数组的getType()仍是kArray，toArray()和[]照常可用
+    bool isPacked() const noexcept;
+    Span<double> packedDoubles() const noexcept;
+    Span<int64_t> packedInts() const noexcept;
+
+public:
+    //结构哈希，相等的Json哈希相同，对象与成员顺序无关，-0和0相同
+    //字符串和容器节点会缓存结果，共享的子树只计算一次
+    //只在进程内稳定，跨进程比较请对canonicalize()的结果做哈希
+    size_t hash() const noexcept;
+    //RFC 8785 JSON Canonicalization Scheme，没有空白，key按UTF-16码元排序
+    //数字按ECMAScript的Number.prototype.toString输出，含NaN或无穷时抛出JsonException
+    std::string canonicalize() const;
+
+public:
+    //是否和other共享同一个节点，共享时两棵子树一定相等
+    bool shares(const Json& other) const noexcept {return _jsonValue == other._jsonValue;}
+
+public:
+    //统计整个文档的内存占用
+    MemoryUsage memoryUsage() const;
+
 public:
     //数组和对象的接口
     size_t size() const;
+    //非const的[]会触发写时复制，只复制被修改路径上的节点，紧凑数组会被展开
+    //交出过可变引用的节点之后不再共享，拷贝时复制这个节点，保证通过引用的修改不会影响拷贝
     //重载[]索引数组
     Json& operator[](size_t);
     const Json& operator[](size_t) const;
-    //重载[]索引对象
+    //重载[]索引对象，非const版本在key不存在时插入null
     Json& operator[](const std::string&);
     const Json& operator[](const std::string&) const; 
+    //只读访问，和const的[]相同，不会让节点失去共享
+    const Json& at(size_t pos) const {return (*this)[pos];}
+    const Json& at(const std::string& key) const {return (*this)[key];}
+
+public:
+    //原地修改数组和对象，修改前先detach()，不影响共享这棵子树的其他Json
+    //类型不符时抛出JsonException，下标越界时抛出std::out_of_range
+    void push_back(Json val);
+    template<class... Args>
+    Json& emplace_back(Args&&... args)
+    {
+        _array& arr = mutableArray();
+        markUnshareable();
+        return arr.emplace_back(std::forward<Args>(args)...);
+    }
+    //数组预留元素个数，对象预留桶
+    void reserve(size_t n);
+    //在pos之前插入
+    void insert(size_t pos, Json val);
+    //key已存在时不覆盖，返回是否插入
+    bool insert(const std::string& key, Json val);
+    //插入或覆盖，返回新的值
+    Json& set(const std::string& key, Json val);
+    void erase(size_t pos);
+    //返回删除的个数
+    size_t erase(const std::string& key);
+    void clear();
+
+private:
+    explicit Json(std::shared_ptr<JsonValue> value) noexcept : _jsonValue(std::move(value)){}
 
 private:
     //辅助函数
     void swap(Json&) noexcept;
-    std::string serializeString() const noexcept;
-    std::string serializeArray() const noexcept;
-    std::string serializeObject() const noexcept;
+    void detach();
+    void unshare();
+    //交出子节点的可变引用之前调用，见JsonValue::markUnshareable()
+    void markUnshareable() noexcept;
+    void adopt(const Json& child) noexcept;
+    _array& mutableArray();
+    _object& mutableObject();
+    void serializeScalar(std::string& res, const SerializeOptions& options) const noexcept;
+    //sink不为空时，res超过缓冲区大小就交给sink写出
+    void serializeTo(std::string& res, const SerializeOptions& options, JsonWriter* sink = nullptr) const;
+
+private:
+    friend bool operator==(const Json&, const Json&);
+    friend class JsonWriter;
+    friend struct NodePool;
+    friend struct PatchAccess;
+    friend class SnapshotValue;
 
 private:
     //智能指针管理json资源
     //实际数据封装在JsonValue对象里，pimpl
-    std::unique_ptr<JsonValue> _jsonValue;
+    //节点用引用计数共享，拷贝为O(1)，修改前由detach()写时复制
+    std::shared_ptr<JsonValue> _jsonValue;
 };
 
 //非成员函数，重载运算符
 bool operator==(const Json&, const Json&);
-inline std::ostream& operator<<(std::ostream& os, const Json& json)
-{
-    return os << json.serialize();
-}
+//经过固定大小的缓冲区流式写出，见jsonWriter.h
+std::ostream& operator<<(std::ostream& os, const Json& json);
 inline bool operator!=(const Json& lhs, const Json& rhs)
 {
     return !(lhs == rhs);   //利用!=实现
 }
-}//namespace LeptJson
\ No newline at end of file
+}//namespace LeptJson
+
+namespace std
+{
+//可以直接放进unordered_set/unordered_map
+template<>
+struct hash<LeptJson::Json>
+{
+    size_t operator()(const LeptJson::Json& json) const noexcept {return json.hash();}
+};
+}//namespace std
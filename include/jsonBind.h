@@ -0,0 +1,268 @@
+#pragma once
+
+#include<cmath>
+#include<cstdint>
+#include<limits>
+#include<string>
+#include<tuple>
+#include<type_traits>
+#include<utility>
+#include<vector>
+#include"json.h"
+#include"jsonException.h"
+#include"parse.h"
+
+namespace LeptJson
+{
+//编译期计算key的哈希，FNV-1a
+constexpr uint64_t hashKey(const char* str, size_t len)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < len; i++)
+    {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//key里没有需要转义的字符时序列化直接写出
+constexpr bool isPlainKey(const char* str, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+    {
+        auto ch = static_cast<unsigned char>(str[i]);
+        if(ch < 0x20 || ch >= 0x80 || ch == '"' || ch == '\\')
+            return false;
+    }
+    return true;
+}
+
+//一个绑定字段：json中的key、key的哈希以及对应的成员指针
+template<class T, class M>
+struct Field
+{
+    const char* name;
+    size_t len;
+    uint64_t hash;
+    bool plain;
+    M T::* member;
+};
+
+template<class T, class M, size_t N>
+constexpr Field<T, M> makeField(const char (&name)[N], M T::* member)
+{
+    return Field<T, M>{name, N - 1, hashKey(name, N - 1), isPlainKey(name, N - 1), member};
+}
+
+//用户通过LEPTJSON_BIND特化，fields为Field组成的tuple
+template<class T>
+struct JsonBinding;
+
+//声明结构体的字段，每个字段只写一次
+//LEPTJSON_BIND(Point, LEPTJSON_FIELD(x), LEPTJSON_FIELD(y))
+#define LEPTJSON_BIND(Type, ...)                                      \
+    template<> struct LeptJson::JsonBinding<Type>                     \
+    {                                                                 \
+        using type = Type;                                            \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__);  \
+    }
+#define LEPTJSON_FIELD(name) LeptJson::makeField(#name, &type::name)
+#define LEPTJSON_FIELD_AS(name, key) LeptJson::makeField(key, &type::name)
+
+namespace detail
+{
+template<class T>
+struct isVector : std::false_type {};
+template<class T, class A>
+struct isVector<std::vector<T, A>> : std::true_type {};
+
+template<class T, class = void>
+struct isBound : std::false_type {};
+template<class T>
+struct isBound<T, std::void_t<decltype(JsonBinding<T>::fields)>> : std::true_type {};
+
+//整数字段不接受小数和超出类型范围的值，name是出错的字段
+template<class T>
+T toInteger(double n, const char* name)
+{
+    //max()+1是2的幂，转换成double没有误差
+    constexpr double upper = static_cast<double>(std::numeric_limits<T>::max() / 2 + 1) * 2;
+    if(n != std::floor(n))
+        throw JsonException(std::string("EXPECT INTEGER: ") + name);
+    if(n < static_cast<double>(std::numeric_limits<T>::min()) || n >= upper)
+        throw JsonException(std::string("INTEGER OUT OF RANGE: ") + name);
+    return static_cast<T>(n);
+}
+
+//直接从解析器读到目标变量，不构造Json树，name是所在字段的key，用于报错
+template<class T>
+void read(Parser& p, T& val, const char* name)
+{
+    if constexpr(std::is_same_v<T, bool>)
+    {
+        val = p.readBool();
+    }
+    else if constexpr(std::is_same_v<T, char>)
+    {
+        std::string str = p.readString();
+        if(str.size() != 1)
+            throw JsonException(std::string("EXPECT ONE CHARACTER: ") + name);
+        val = str[0];
+    }
+    else if constexpr(std::is_integral_v<T>)
+    {
+        val = toInteger<T>(p.readNumber(), name);
+    }
+    else if constexpr(std::is_arithmetic_v<T>)
+    {
+        val = static_cast<T>(p.readNumber());
+    }
+    else if constexpr(std::is_same_v<T, std::string>)
+    {
+        val = p.readString();
+    }
+    else if constexpr(std::is_same_v<T, Json>)
+    {
+        val = p.readValue();
+    }
+    else if constexpr(isVector<T>::value)
+    {
+        val.clear();
+        p.expect('[', "EXPECT ARRAY");
+        if(p.consume(']'))
+            return;
+        do
+        {
+            //vector<bool>的back()返回代理对象，先读到局部变量
+            typename T::value_type element{};
+            read(p, element, name);
+            val.push_back(std::move(element));
+        } while(p.consume(','));
+        p.expect(']', "MISS COMMA OR SQUARE BRACKET");
+    }
+    else
+    {
+        static_assert(isBound<T>::value, "type is not bound by LEPTJSON_BIND");
+        p.expect('{', "EXPECT OBJECT");
+        if(p.consume('}'))
+            return;
+        do
+        {
+            std::string key = p.readString();
+            p.expect(':', "MISS COLON");
+            uint64_t hash = hashKey(key.data(), key.size());
+            //先比较编译期算好的哈希，命中后再比较key本身
+            bool matched = std::apply([&](const auto&... field) {
+                return ((field.hash == hash && key.size() == field.len
+                         && key.compare(0, field.len, field.name, field.len) == 0
+                         ? (read(p, val.*(field.member), field.name), true) : false) || ...);
+            }, JsonBinding<T>::fields);
+            if(!matched)
+                p.skipValue();
+        } while(p.consume(','));
+        p.expect('}', "MISS COMMA OR CURLY BRACKET");
+    }
+}
+
+template<class T, class M>
+void writeKey(std::string& out, const Field<T, M>& field)
+{
+    if(field.plain)
+    {
+        out += '"';
+        out.append(field.name, field.len);
+        out += '"';
+    }
+    else
+    {
+        Json::escapeString(std::string(field.name, field.len), out);
+    }
+}
+
+//直接从结构体字段写出json文本，name是所在字段的key，用于报错
+template<class T>
+void write(std::string& out, const T& val, const char* name)
+{
+    if constexpr(std::is_same_v<T, bool>)
+    {
+        out += val ? "true" : "false";
+    }
+    else if constexpr(std::is_same_v<T, char>)
+    {
+        Json::escapeString(std::string(1, val), out);
+    }
+    else if constexpr(std::is_integral_v<T>)
+    {
+        out += std::to_string(val);
+    }
+    else if constexpr(std::is_floating_point_v<T>)
+    {
+        //JSON没有NaN和无穷
+        if(!std::isfinite(val))
+            throw JsonException(std::string("NUMBER NOT FINITE: ") + name);
+        Json::formatNumber(static_cast<double>(val), out);
+    }
+    else if constexpr(std::is_same_v<T, std::string>)
+    {
+        Json::escapeString(val, out);
+    }
+    else if constexpr(std::is_same_v<T, Json>)
+    {
+        out += val.serialize();
+    }
+    else if constexpr(isVector<T>::value)
+    {
+        out += '[';
+        for(size_t i = 0; i < val.size(); i++)
+        {
+            if(i > 0)
+                out += ',';
+            write(out, val[i], name);
+        }
+        out += ']';
+    }
+    else
+    {
+        static_assert(isBound<T>::value, "type is not bound by LEPTJSON_BIND");
+        out += '{';
+        bool first = true;
+        std::apply([&](const auto&... field) {
+            ((out += first ? "" : ",", first = false,
+              writeKey(out, field), out += ':',
+              write(out, val.*(field.member), field.name)), ...);
+        }, JsonBinding<T>::fields);
+        out += '}';
+    }
+}
+}//namespace detail
+
+//把json文本直接解析到绑定过的结构体，失败时返回false并设置errMsg
+//json中没有出现的字段保持原值，多余的key被跳过
+template<class T>
+bool fromJson(const std::string& content, T& val, std::string& errMsg)
+{
+    try
+    {
+        Parser p(content);
+        detail::read(p, val, "/");
+        p.finish();
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        return false;
+    }
+}
+
+//把绑定过的结构体直接序列化为json文本，浮点字段是NaN或无穷时抛出JsonException
+//char字段读写成只有一个字符的字符串，signed char和unsigned char按整数处理
+template<class T>
+std::string toJson(const T& val)
+{
+    std::string out;
+    detail::write(out, val, "/");
+    return out;
+}
+}//namespace LeptJson
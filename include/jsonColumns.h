@@ -0,0 +1,74 @@
+#pragma once
+
+#include<cstdint>
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
+#include"json.h"
+
+namespace LeptJson
+{
+class Parser;
+
+enum class ColumnType {kBool, kInt, kDouble, kString};
+
+//一个字段的所有值，每行在对应类型的数组里都占一个位置，null和缺失的字段填默认值
+//validity按位记录每行是否有值，第row行对应validity[row / 64]的第row % 64位
+struct Column
+{
+    std::string name;
+    ColumnType type;
+    std::vector<uint64_t> validity;
+    std::vector<uint8_t> bools;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    //第row行的字符串是bytes[offsets[row], offsets[row + 1])
+    std::vector<uint64_t> offsets{0};
+    std::string bytes;
+
+    bool isValid(size_t row) const noexcept {return validity[row / 64] >> (row % 64) & 1;}
+    std::string_view stringAt(size_t row) const noexcept
+    {
+        return std::string_view(bytes.data() + offsets[row], offsets[row + 1] - offsets[row]);
+    }
+};
+
+struct ColumnOptions
+{
+    //用前多少条记录推断列和类型，为0时按1处理
+    size_t inferRows = 100;
+};
+
+//把对象数组转成按列存放的表，用于批量的统计计算
+//列由前inferRows条记录推断：只含整数的为kInt，有小数的为kDouble，bool和字符串各自成列
+//只能按列存放标量，值是容器、类型混杂或者全是null的字段不提取
+//之后的记录中没有推断出来的字段被跳过，整数列遇到小数时整列转成kDouble，其他类型不符时报COLUMN TYPE MISMATCH
+class ColumnTable
+{
+public:
+    //从已经解析好的对象数组提取，失败时返回false并设置errMsg
+    bool load(const Json& records, std::string& errMsg, const ColumnOptions& options = ColumnOptions()) noexcept;
+    //直接从json文本提取，推断完列之后的记录不构造Json，也不为每条记录建哈希表
+    bool parse(const std::string& content, std::string& errMsg,
+               const ColumnOptions& options = ColumnOptions()) noexcept;
+
+public:
+    size_t rows() const noexcept {return _rows;}
+    const std::vector<Column>& columns() const noexcept {return _columns;}
+    //没有这一列时返回nullptr
+    const Column* column(std::string_view name) const noexcept;
+
+private:
+    void infer(const Json* records, size_t count);
+    void append(const Json& record);
+    void read(Parser& p);
+    void beginRow();
+    Column* find(const std::string& key, size_t& hint);
+
+private:
+    size_t _rows = 0;
+    std::vector<Column> _columns;
+    std::unordered_map<std::string, size_t> _index;   //列名到_columns下标
+};
+}//namespace LeptJson
@@ -0,0 +1,24 @@
+#pragma once
+
+#include<string>
+#include"json.h"
+
+namespace LeptJson
+{
+//按JSON Pointer(RFC 6901)查找，找不到或路径非法时返回nullptr
+//""表示根，"/a~1b/0"表示key为"a/b"的成员的第0个元素
+const Json* resolvePointer(const Json& root, const std::string& pointer) noexcept;
+
+//RFC 7386 Merge Patch，原地修改target
+//patch中的null表示删除，对象递归合并，其他值直接替换
+void mergePatch(Json& target, const Json& patch);
+
+//RFC 6902 JSON Patch，patch为操作数组，支持add/remove/replace/move/copy/test
+//直接在target上修改，不复制整个文档，被其他Json共享的节点沿修改路径复制
+//每一步记下撤销操作，任何一步失败时倒序撤销，target的内容恢复原样，返回false并设置errMsg
+bool applyPatch(Json& target, const Json& patch, std::string& errMsg) noexcept;
+
+//生成把from变成to的JSON Patch，共享同一节点的子树直接跳过
+//数组只比较去掉公共前后缀后的部分，按位置逐个比较，不做LCS
+Json diff(const Json& from, const Json& to);
+}//namespace LeptJson
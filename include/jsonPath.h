@@ -0,0 +1,40 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include"json.h"
+
+namespace LeptJson
+{
+struct PathOptions
+{
+    //大数组上的过滤分给多少个线程，1表示在调用线程上完成
+    size_t threads = 1;
+    //元素少于这个数的数组不拆分
+    size_t parallelThreshold = 16384;
+};
+
+//JSONPath查询，支持：
+//$、.name、['name']、[n]（负数从末尾数）、[start:end:step]、.*和[*]、[a,'b']、..递归下降
+//过滤[?(...)]：@或$开头的单值路径、数字字符串和true/false/null字面量、
+//== != < <= > >=、&&、||、!和括号，单独的路径表示该路径存在
+//查询只编译一次，之后可以在多个线程中对不同的文档重复使用
+class JsonPath
+{
+public:
+    //编译查询，语法错误时抛出JsonException("INVALID JSONPATH: ...")
+    explicit JsonPath(const std::string& expression);
+    ~JsonPath();
+
+public:
+    //按文档顺序返回匹配的节点，不复制节点，指针在root被修改或析构之前有效
+    std::vector<const Json*> select(const Json& root, const PathOptions& options = PathOptions()) const;
+
+public:
+    struct Plan;
+
+private:
+    std::shared_ptr<const Plan> _plan;
+};
+}//namespace LeptJson
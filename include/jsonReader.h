@@ -0,0 +1,31 @@
+#pragma once
+
+#include<functional>
+#include<string>
+#include"json.h"
+
+namespace LeptJson
+{
+//分块输入：把至多capacity个字节写进dest，返回写入的字节数，返回0表示输入结束
+using ChunkReader = std::function<size_t(char* dest, size_t capacity)>;
+
+//从分块输入解析，结果和Json::parse()相同
+//缓冲区里只保留还没解析完的token，整个文本不会同时存在于内存中
+Json parseChunked(ChunkReader reader, std::string& errMsg, const ParseOptions& options = ParseOptions()) noexcept;
+
+struct GzipOptions
+{
+    //环形缓冲区的块数和每块的大小，解压线程最多领先解析slots块
+    size_t slots = 4;
+    size_t slotSize = 256 * 1024;
+};
+
+//解析gzip或zlib压缩的JSON，格式自动识别，支持多个gzip成员拼接
+//解压在单独的线程上进行，解压出的数据经过环形缓冲区交给调用线程上的解析
+//压缩数据损坏或被截断时报INVALID GZIP，解压和解析的错误同时出现时报解压的错误
+Json parseGzip(const void* data, size_t size, std::string& errMsg, const ParseOptions& options = ParseOptions(),
+               const GzipOptions& gzip = GzipOptions()) noexcept;
+//压缩文件也是分块读取的，打不开时报CANNOT OPEN
+Json parseGzipFile(const std::string& path, std::string& errMsg, const ParseOptions& options = ParseOptions(),
+                   const GzipOptions& gzip = GzipOptions()) noexcept;
+}//namespace LeptJson
@@ -0,0 +1,40 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include"json.h"
+
+namespace LeptJson
+{
+class Parser;
+
+//JSON Schema校验器，支持draft-07的一个子集：
+//type、properties、required、additionalProperties、items、enum、
+//minimum/maximum、exclusiveMinimum/exclusiveMaximum、
+//minLength/maxLength、minItems/maxItems、pattern
+//schema只编译一次，之后可以在多个线程中重复使用
+class Schema
+{
+public:
+    //编译schema，不认识的关键字被忽略，schema本身不合法时抛出JsonException
+    explicit Schema(const Json& schema);
+    ~Schema();
+
+public:
+    //校验已经解析好的Json树，失败时返回false并设置errMsg
+    //errMsg中的位置是JSON Pointer，正则超出std::regex的复杂度限制时报PATTERN TOO COMPLEX
+    bool validate(const Json& json, std::string& errMsg) const noexcept;
+    //边解析边校验，第一个不符合schema的值处立即失败，不会构造出完整的树
+    //失败时返回null并设置errMsg，解析错误和校验错误都通过errMsg返回
+    Json parse(const std::string& content, std::string& errMsg) const noexcept;
+
+public:
+    struct Node;
+
+private:
+    Json parseValue(Parser& p, const Node* node, std::string& path) const;
+
+private:
+    std::shared_ptr<const Node> _root;
+};
+}//namespace LeptJson
@@ -1,11 +1,55 @@
 #pragma once
 
+#include<atomic>
+#include<memory>
+#include<mutex>
 #include<variant>
 #include"json.h"
 #include"jsonException.h"
 
 namespace LeptJson
 {
+//紧凑存储的数值数组，整数存int64_t，其余存double，两个缓冲区只用其中一个
+//需要Json元素时在elements里构造一次，call_once保证多个线程并发读取时只构造一次
+struct PackedNumbers
+{
+    explicit PackedNumbers(std::pmr::vector<double>&& values);
+    //拷贝只复制数值，元素在需要时重新构造
+    PackedNumbers(const PackedNumbers& rhs) : doubles(rhs.doubles), ints(rhs.ints), integral(rhs.integral){}
+    PackedNumbers(const PackedNumbers& rhs, std::pmr::memory_resource* resource)
+        : doubles(rhs.doubles, resource), ints(rhs.ints, resource), integral(rhs.integral), elements(resource){}
+
+    size_t size() const noexcept {return integral ? ints.size() : doubles.size();}
+    double at(size_t i) const noexcept {return integral ? static_cast<double>(ints[i]) : doubles[i];}
+    const Json::_array& materialize() const;
+    //元素已经构造好时返回它们，否则返回nullptr，不会触发构造
+    const Json::_array* materialized() const noexcept
+    {
+        return ready.load(std::memory_order_acquire) ? &elements : nullptr;
+    }
+
+    std::pmr::vector<double> doubles;
+    std::pmr::vector<int64_t> ints;
+    bool integral;
+    mutable std::once_flag once;
+    mutable std::atomic<bool> ready{false};
+    mutable Json::_array elements;
+};
+
+//容器缓存的序列化结果，以及生成它时的转义选项
+struct SerializedFragment
+{
+    std::string text;
+    bool escapeUnicode;
+    bool escapeSlash;
+};
+
+//rawNumbers解析出的数字，保存已经校验过语法的原文
+struct RawNumber
+{
+    std::string text;
+};
+
 class JsonValue
 {
 public:
@@ -19,13 +63,21 @@ public:
 
 public:
     //移动构造
-    explicit JsonValue(const std::string&& val) : _val(std::move(val)){}
-    explicit JsonValue(const Json::_array&& val) : _val(std::move(val)){}
-    explicit JsonValue(const Json::_object&& val) : _val(std::move(val)){}
+    explicit JsonValue(std::string&& val) : _val(std::move(val)){}
+    explicit JsonValue(Json::_array&& val) : _val(std::move(val)){}
+    explicit JsonValue(Json::_object&& val) : _val(std::move(val)){}
+    explicit JsonValue(std::pmr::vector<double>&& values) : _val(std::in_place_type<PackedNumbers>, std::move(values)){}
+    explicit JsonValue(RawNumber&& val) : _val(std::move(val)){}
+
+public:
+    //拷贝只复制值，哈希和序列化缓存不复制，拷贝出来的节点马上就要被修改
+    JsonValue(const JsonValue& rhs) : _val(rhs._val){}
+    //容器复制到resource上，resource为空时与上面相同
+    JsonValue(const JsonValue& rhs, std::pmr::memory_resource* resource);
 
 public:
     //析构函数
-    ~JsonValue() = default;
+    ~JsonValue() {delete _fragment.load(std::memory_order_relaxed);}
 
 public:
     JsonType getType() const noexcept;
@@ -35,10 +87,72 @@ public:
     std::nullptr_t toNull() const;
     bool toBool() const;
     double toNumber() const;
+    int64_t toInt64() const;
     const std::string& toString() const;
     const Json::_array& toArray() const;
     const Json::_object& toObject() const;
 
+public:
+    //可修改的容器，类型不符时返回空指针
+    Json::_array* getArray() noexcept {return std::get_if<Json::_array>(&_val);}
+    Json::_object* getObject() noexcept {return std::get_if<Json::_object>(&_val);}
+    const Json::_array* getArray() const noexcept {return std::get_if<Json::_array>(&_val);}
+    const Json::_object* getObject() const noexcept {return std::get_if<Json::_object>(&_val);}
+    //紧凑数组，getArray()对它返回空指针
+    const PackedNumbers* getPacked() const noexcept {return std::get_if<PackedNumbers>(&_val);}
+    std::string* getString() noexcept {return std::get_if<std::string>(&_val);}
+    const RawNumber* getRawNumber() const noexcept {return std::get_if<RawNumber>(&_val);}
+    //容器所在的memory_resource，标量和默认堆上的容器返回nullptr
+    std::pmr::memory_resource* resource() const noexcept;
+    //回收的节点改写成新的值
+    template<class T>
+    void assign(T&& val)
+    {
+        _val = std::forward<T>(val);
+        recycle();
+    }
+    //节点回收给parseInto()重用，清除缓存和不能共享的标记，原来文档里的引用都已失效
+    void recycle() noexcept
+    {
+        resetCache();
+        _unshareable = false;
+    }
+    //紧凑数组展开成普通数组，只能在独占节点时调用
+    void unpack();
+    //容器交出过子节点的可变引用，之后通过引用的修改不经过detach()，节点不能再被共享
+    //标记不会清除，拷贝时复制节点，复制出来的节点没有标记，见Json::unshare()
+    void markUnshareable() noexcept {_unshareable = true;}
+    bool unshareable() const noexcept {return _unshareable;}
+
+public:
+    //缓存的结构哈希，0表示还没有计算，节点被修改前由Json::detach()清除
+    //交出过可变引用的节点可能不经过detach()被修改，不缓存
+    //多个线程同时计算得到的值相同，用relaxed即可
+    size_t cachedHash() const noexcept {return _hash.load(std::memory_order_relaxed);}
+    void cacheHash(size_t hash) const noexcept
+    {
+        if(!_unshareable)
+            _hash.store(hash, std::memory_order_relaxed);
+    }
+    //序列化缓存，见SerializeOptions::cacheFragments
+    const SerializedFragment* fragment() const noexcept {return _fragment.load(std::memory_order_acquire);}
+    //多个线程同时序列化时只有第一个存进去，其余的丢弃，和哈希一样不缓存在交出过可变引用的节点上
+    void cacheFragment(std::unique_ptr<SerializedFragment> fragment) const noexcept
+    {
+        if(_unshareable)
+            return;
+        const SerializedFragment* expected = nullptr;
+        if(_fragment.compare_exchange_strong(expected, fragment.get(), std::memory_order_release,
+                                             std::memory_order_relaxed))
+            fragment.release();
+    }
+    //清除哈希和序列化缓存，只在独占节点时调用，不会有其他线程正在读缓存
+    void resetCache() noexcept
+    {
+        _hash.store(0, std::memory_order_relaxed);
+        delete _fragment.exchange(nullptr, std::memory_order_relaxed);
+    }
+
 public:
     //数组和对象随机存取
     size_t size() const;
@@ -48,6 +162,9 @@ public:
     const Json& operator[](const std::string&) const; 
 
 private:
-    std::variant<std::nullptr_t, bool, double, std::string, Json::_array, Json::_object> _val;
+    std::variant<std::nullptr_t, bool, double, std::string, Json::_array, Json::_object, PackedNumbers, RawNumber> _val;
+    mutable std::atomic<size_t> _hash{0};
+    mutable std::atomic<const SerializedFragment*> _fragment{nullptr};
+    bool _unshareable = false;
 };
 }//namespace LeptJson
\ No newline at end of file
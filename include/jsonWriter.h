@@ -0,0 +1,121 @@
+#pragma once
+
+#include<cstdio>
+#include<functional>
+#include<iosfwd>
+#include<string>
+#include<vector>
+#include"json.h"
+
+namespace LeptJson
+{
+//流式序列化，内容先写进固定大小的缓冲区，满了就交给输出端
+//内存占用只和缓冲区大小以及最长的单个标量有关，和文档大小无关
+//输出失败后后续的写入都被丢弃，write()/flush()返回false
+class JsonWriter
+{
+public:
+    explicit JsonWriter(size_t bufferSize = kDefaultBufferSize);
+    //派生类析构时写出缓冲区里剩余的内容
+    virtual ~JsonWriter() = default;
+
+public:
+    //禁用拷贝
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+public:
+    //序列化json，格式和Json::serialize()相同
+    bool write(const Json& json, const SerializeOptions& options = SerializeOptions());
+    //写入原始文本，比如多个文档之间的换行
+    bool write(const char* data, size_t len);
+    bool flush();
+    bool good() const noexcept {return _good;}
+
+public:
+    static constexpr size_t kDefaultBufferSize = 64 * 1024;
+
+protected:
+    //把chunk交给输出端，返回后chunk必须为空，可以swap走以避免拷贝
+    virtual bool output(std::string& chunk) = 0;
+    //缓冲区内容都交给output()之后调用，用于写出输出端自己攒下的数据
+    virtual bool sync() {return true;}
+    //派生类的析构函数里调用，此时虚函数还指向派生类
+    void finish() noexcept;
+
+private:
+    friend class Json;
+    //序列化过程中缓冲区满时由Json::serializeTo()调用
+    void spill();
+    //追加一段可能很长的文本，按缓冲区大小分块交给输出端
+    void spill(const char* data, size_t len);
+
+private:
+    std::string _buffer;
+    size_t _bufferSize;
+    bool _good = true;
+};
+
+//写到文件描述符，batch大于1时攒够batch块再用一次writev写出
+//不负责关闭fd
+class FdWriter : public JsonWriter
+{
+public:
+    explicit FdWriter(int fd, size_t bufferSize = kDefaultBufferSize, size_t batch = 1);
+    ~FdWriter() override;
+
+protected:
+    bool output(std::string& chunk) override;
+    bool sync() override;
+
+private:
+    int _fd;
+    size_t _batch;
+    std::vector<std::string> _chunks;
+    std::vector<std::string> _spare;
+};
+
+//写到FILE*，不负责关闭
+class FileWriter : public JsonWriter
+{
+public:
+    explicit FileWriter(FILE* file, size_t bufferSize = kDefaultBufferSize);
+    ~FileWriter() override;
+
+protected:
+    bool output(std::string& chunk) override;
+    bool sync() override;
+
+private:
+    FILE* _file;
+};
+
+//写到std::ostream
+class StreamWriter : public JsonWriter
+{
+public:
+    explicit StreamWriter(std::ostream& os, size_t bufferSize = kDefaultBufferSize);
+    ~StreamWriter() override;
+
+protected:
+    bool output(std::string& chunk) override;
+
+private:
+    std::ostream& _os;
+};
+
+//交给用户回调，回调返回false表示输出失败
+class CallbackWriter : public JsonWriter
+{
+public:
+    using Callback = std::function<bool(const char* data, size_t len)>;
+    explicit CallbackWriter(Callback callback, size_t bufferSize = kDefaultBufferSize);
+    ~CallbackWriter() override;
+
+protected:
+    bool output(std::string& chunk) override;
+
+private:
+    Callback _callback;
+};
+}//namespace LeptJson
@@ -1,48 +1,194 @@
 #pragma once
 
+#include<cstring>
 #include"json.h"
 #include"jsonException.h"
+#include"jsonReader.h"
+#ifdef LEPTJSON_PARSE_STATS
+#include<chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h>
+#endif
+#endif
 
 namespace LeptJson
 {
 constexpr bool is1to9(char ch) {return ch >= '1' && ch <= '9';}
 constexpr bool is0to9(char ch) {return ch >= '0' && ch <= '9';}
 
+#ifdef LEPTJSON_PARSE_STATS
+//读取周期计数器，x86上用rdtsc，其他平台退化为纳秒
+inline uint64_t readCycles() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//作用域计时器，析构时把经过的周期加到counter上
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(uint64_t* counter) noexcept : _counter(counter), _begin(counter ? readCycles() : 0){}
+    ~PhaseTimer() {if(_counter) *_counter += readCycles() - _begin;}
+
+private:
+    uint64_t* _counter;
+    uint64_t _begin;
+};
+
+//统计开启且调用方传入了ParseStats时才执行
+#define LEPTJSON_STAT(expr) do { if(_stats) { _stats->expr; } } while(0)
+#define LEPTJSON_TIMER(phase) PhaseTimer _phaseTimer(_stats ? &_stats->phase : nullptr)
+#else
+//关闭统计时展开为空，不产生任何代码
+#define LEPTJSON_STAT(expr) do {} while(0)
+#define LEPTJSON_TIMER(phase) do {} while(0)
+#endif
+
+//parseInto()从旧文档回收的节点，数组和字符串清空后保留容量
+//对象保留原来的key，值取走后留空，同样的key再次出现时直接填回去，没有再出现的key在对象结束时删除
+//只回收没有被其他Json共享、并且分配自默认堆的节点
+struct NodePool
+{
+    std::vector<std::shared_ptr<JsonValue>> scalars;
+    std::vector<std::shared_ptr<JsonValue>> strings;
+    std::vector<std::shared_ptr<JsonValue>> arrays;
+    std::vector<std::shared_ptr<JsonValue>> objects;
+
+    //拆开root，可以回收的节点放进池里，root变为空
+    void collect(Json& root);
+    //取一个节点，池里没有时新建，标量的值由调用方改写
+    std::shared_ptr<JsonValue> take(JsonType type);
+    static Json wrap(std::shared_ptr<JsonValue> node) noexcept {return Json(std::move(node));}
+    //回收的对象中还没有填回值的成员
+    static bool vacant(const Json& json) noexcept {return !json._jsonValue;}
+};
+
+//字段投影编译成的前缀树，all表示整个子树都要保留
+struct Projection
+{
+    bool all = false;
+    std::unordered_map<std::string, Projection> children;
+};
+
 class Parser
 {
 public:
     //构造函数
-    explicit Parser(const char* cstr) noexcept : _start(cstr), _curr(cstr){}
-    explicit Parser(const std::string& content) noexcept : _start(content.c_str()), _curr(content.c_str()) {}
+    explicit Parser(const char* cstr) noexcept : _start(cstr), _curr(cstr), _end(cstr + strlen(cstr)){}
+    explicit Parser(const std::string& content) noexcept
+        : _start(content.c_str()), _curr(content.c_str()), _end(content.c_str() + content.size()) {}
+    Parser(const std::string& content, const ParseOptions& options);
+    //分块输入，缓冲区里只保留还没解析完的token，见fill()
+    Parser(ChunkReader reader, const ParseOptions& options);
 
 public:
     //禁用拷贝，只能有一个解析器
     Parser(const Parser&) = delete;
     Parser& operator=(const Parser&) = delete;
 
+private:
+    Parser(const char* begin, const char* end, const ParseOptions& options);
+
 private:
     //辅助函数
-    void parseWhitespace() noexcept;
+    void parseWhitespace();
     unsigned parse4hex();
     std::string encodeUTF8(unsigned u) noexcept;
     std::string parseRawString();
-    void error(const std::string& msg) const;
+    double parseRawNumber();
+    void scanNumber();
+    [[noreturn]] void error(const std::string& msg) const;
+    void parseRawString(std::string& str);
+    void skipRawString();
+    bool fill();
+    //保证_curr之后至少有n个字节，除非输入已经结束
+    void ensure(size_t n)
+    {
+        while(_reader && static_cast<size_t>(_end - _curr) < n && fill())
+            ;
+    }
+
+private:
+    //显式栈上的一层容器，代替递归
+    struct Frame
+    {
+        Frame(bool object, const Projection* projection, std::pmr::memory_resource* resource, bool pack)
+            : isObject(object), packing(pack), select(projection), arr(resource), obj(resource), numbers(resource){}
+
+        bool isObject;
+        bool packing;               //数组到目前为止全是数字，元素存在numbers里
+        const Projection* select;   //该容器的字段投影
+        Json::_array arr;
+        Json::_object obj;
+        std::pmr::vector<double> numbers;
+        std::string key;            //对象中正在解析的值对应的key
+        std::shared_ptr<JsonValue> node;    //回收来的容器节点，arr或obj借用它的容量
+        size_t filled = 0;          //回收的对象中已经有值的成员数
+    };
 
 private:
     //解析不同类型的值
     Json parseValue();
+    Json beginValue();
+    void openContainer(bool object);
+    Json closeContainer();
+    void addMember(Frame& frame, Json value);
+    template<class T>
+    Json makeScalar(T val);
+    bool nextKey(Frame& frame);
+    bool packNumbers(Frame& frame);
     Json parseLiteral(const std::string& literal);
     Json parseNumber();
     Json parseString();
-    Json parseArray();
-    Json parseObject();
 
 public:
     //唯一的调用接口
     Json parse();
+    //之后创建的节点优先从pool里取，有resource时不使用
+    void reuse(NodePool* pool) noexcept {_pool = _resource ? nullptr : pool;}
+
+public:
+    //逐个token读取的接口，供结构体绑定等不经过Json树的解析使用
+    //出错时和parse()一样抛出JsonException
+    char peek();
+    bool consume(char ch);
+    void expect(char ch, const std::string& msg);
+    std::string readString();
+    double readNumber();
+    bool readBool();
+    void readNull();
+    Json readValue();
+    void skipValue();
+    void finish();
 
 private:
     const char* _start; //开始解析的位置
     const char* _curr;  //当前的解析位置
+    const char* _end;   //输入的末尾，即结尾'\0'的位置
+    std::unique_ptr<Projection> _projection;    //字段投影，为空时构造全部
+    const Projection* _select = nullptr;        //当前层级选中的字段，为空时构造全部
+    std::pmr::memory_resource* _resource = nullptr; //节点和容器的分配来源，为空时用默认的堆
+    ParseStats* _stats = nullptr;   //解析统计，编译时未开启LEPTJSON_PARSE_STATS则始终不用
+    size_t _maxDepth = kDefaultMaxDepth;    //容器最大嵌套深度
+    bool _strictUtf8 = false;       //是否严格校验字符串的UTF-8编码
+    bool _packNumbers = false;      //全是数字的数组是否存成紧凑数组
+    bool _rawNumbers = false;       //数字保存原文，不转换
+    std::vector<Frame> _stack;      //正在解析的容器
+    ChunkReader _reader;            //分块输入，为空时整个输入都在[_start, _end)里
+    std::string _window;            //分块输入的缓冲区
+    bool _eof = false;              //分块输入已经读完
+    NodePool* _pool = nullptr;      //parseInto()回收的节点
+
+public:
+    //分块输入时每个token开始前至少准备好的字节数，足够放下字面量和常见的数字
+    //更长的数字和字符串在读到缓冲区末尾时再补充
+    static constexpr size_t kLookahead = 64;
+    //每次从分块输入读取的字节数
+    static constexpr size_t kChunkSize = 64 * 1024;
 };
 }//namespace LeptJson
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include<atomic>
+#include<list>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<unordered_map>
+#include<vector>
+#include"json.h"
+
+namespace LeptJson
+{
+//并发解析缓存，按内容哈希缓存解析结果
+//返回的文档是只读共享的，多个线程可以无锁读取
+//分片降低锁竞争，每个分片是一个有容量上限的LRU
+class ParseCache
+{
+public:
+    //capacity为所有分片的总容量，shardCount大于capacity时只用capacity个分片
+    explicit ParseCache(size_t capacity = 1024, size_t shardCount = 16);
+
+public:
+    //禁用拷贝
+    ParseCache(const ParseCache&) = delete;
+    ParseCache& operator=(const ParseCache&) = delete;
+
+public:
+    //命中时直接返回缓存的文档，否则解析并缓存，解析失败返回nullptr并设置errMsg
+    std::shared_ptr<const Json> parse(const std::string& content, std::string& errMsg);
+
+public:
+    //统计和管理接口
+    size_t size() const;
+    size_t hits() const noexcept {return _hits.load(std::memory_order_relaxed);}
+    size_t misses() const noexcept {return _misses.load(std::memory_order_relaxed);}
+    void clear();
+
+private:
+    struct Entry
+    {
+        size_t hash;
+        std::string content;
+        std::shared_ptr<const Json> json;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex mtx;
+        std::list<Entry> lru;   //表头为最近使用
+        std::unordered_map<size_t, std::list<Entry>::iterator> index;
+        size_t capacity;
+    };
+
+private:
+    Shard& shardOf(size_t hash) noexcept {return *_shards[hash % _shards.size()];}
+
+private:
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<size_t> _hits{0};
+    std::atomic<size_t> _misses{0};
+};
+}//namespace LeptJson
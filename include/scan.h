@@ -0,0 +1,20 @@
+#pragma once
+
+#include<cstddef>
+
+namespace LeptJson
+{
+//字节扫描工具，有SSE2时一次处理16个字节，否则逐字节处理
+//调用方保证[begin, end)可读，不会越过end读取
+
+//返回第一个需要特殊处理的字符：引号、反斜杠或小于0x20的控制字符，没有时返回end
+const char* scanStringRun(const char* begin, const char* end) noexcept;
+
+//序列化时找下一个需要转义的字符，在scanStringRun的基础上
+//nonAscii为true时包括所有非ASCII字节，slash为true时包括/
+const char* scanEscapeRun(const char* begin, const char* end, bool nonAscii, bool slash) noexcept;
+
+//严格校验UTF-8：拒绝截断的序列、超长编码、代理区码点和超过U+10FFFF的码点
+//纯ASCII的16字节块直接跳过
+bool isValidUtf8(const char* begin, const char* end) noexcept;
+}//namespace LeptJson
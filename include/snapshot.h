@@ -0,0 +1,138 @@
+#pragma once
+
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<string_view>
+#include"json.h"
+
+namespace LeptJson
+{
+//二进制快照格式的版本，布局变化时加一
+constexpr uint32_t kSnapshotVersion = 1;
+
+//快照文件头，后面依次是节点表、子节点表和字符串区，全部用下标和偏移，不含指针
+//1. 节点表：nodeCount个SnapshotNode，0号是根
+//2. 子节点表：wordCount个uint64_t，数组每个元素一个节点下标
+//   对象每个成员三个：key偏移、key长度、节点下标，按key的字节序排好，查找用二分
+//3. 字符串区：字符串值和key的内容，相同的key只存一份
+struct SnapshotHeader
+{
+    char magic[8];          //"LEPTSNAP"
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t endianTag;     //写入时的字节序，读取端不同则拒绝
+    uint64_t nodeCount;
+    uint64_t wordCount;
+    uint64_t stringBytes;
+    uint64_t checksum;      //文件头之后全部内容的校验和
+    uint64_t reserved;
+};
+
+//type为JsonType，a和b的含义随类型不同：
+//bool: a为0或1；string: a为偏移，b为长度
+//number: a为double的位模式，rawNumbers解析出的数字b和c为原文的偏移和长度，c为0表示没有原文
+//数组和对象: a为元素个数，b为子节点表中的起点
+struct SnapshotNode
+{
+    uint32_t type;
+    uint32_t c;
+    uint64_t a;
+    uint64_t b;
+};
+
+class Snapshot;
+
+//快照中一个值的只读视图，直接读映射的内存，不做反序列化
+//偏移越界时抛出JsonException("CORRUPT SNAPSHOT")
+class SnapshotValue
+{
+public:
+    JsonType getType() const noexcept;
+    bool isNull() const noexcept {return getType() == JsonType::kNull;}
+    bool isBool() const noexcept {return getType() == JsonType::kBool;}
+    bool isNumber() const noexcept {return getType() == JsonType::kNumber;}
+    bool isString() const noexcept {return getType() == JsonType::kString;}
+    bool isArray() const noexcept {return getType() == JsonType::kArray;}
+    bool isObject() const noexcept {return getType() == JsonType::kObject;}
+
+public:
+    bool toBool() const;
+    double toNumber() const;
+    std::string_view toString() const;
+
+public:
+    //数组下标访问O(1)，对象按key二分查找，找不到时抛出JsonException
+    size_t size() const;
+    SnapshotValue operator[](size_t pos) const;
+    SnapshotValue operator[](std::string_view key) const;
+    bool contains(std::string_view key) const;
+    //对象第pos个成员的key和值，按key的字节序排列
+    std::string_view key(size_t pos) const;
+    SnapshotValue value(size_t pos) const;
+
+public:
+    //复制成普通的Json
+    Json toJson() const;
+
+private:
+    friend class Snapshot;
+    SnapshotValue(const Snapshot* snapshot, uint64_t index) noexcept : _snapshot(snapshot), _index(index){}
+    const SnapshotNode& node() const;
+    const uint64_t* children() const;
+    std::string_view text(uint64_t offset, uint64_t length) const;
+    //二分查找，找不到返回false
+    bool find(std::string_view key, uint64_t& index) const;
+
+private:
+    const Snapshot* _snapshot;
+    uint64_t _index;
+};
+
+//只读快照，可以从文件mmap或者直接使用一段内存
+//打开时只检查文件头和各区的大小，不逐页读取，页面在访问时才载入
+//verifyChecksum为true时先计算一遍校验和，会读完整个文件
+//多个线程可以同时读同一个快照
+class Snapshot
+{
+public:
+    ~Snapshot();
+
+public:
+    //禁用拷贝
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+public:
+    //生成快照的字节内容，或者直接写到文件，失败时返回false并设置errMsg
+    static std::string build(const Json& json);
+    static bool save(const Json& json, const std::string& path, std::string& errMsg) noexcept;
+
+    //打开失败时返回nullptr并设置errMsg
+    static std::unique_ptr<Snapshot> open(const std::string& path, std::string& errMsg,
+                                          bool verifyChecksum = false) noexcept;
+    //不复制也不接管data，data要比Snapshot活得更久，并且按8字节对齐
+    static std::unique_ptr<Snapshot> fromBuffer(const void* data, size_t size, std::string& errMsg,
+                                                bool verifyChecksum = false) noexcept;
+
+public:
+    SnapshotValue root() const noexcept {return SnapshotValue(this, 0);}
+    size_t byteSize() const noexcept {return _size;}
+
+private:
+    friend class SnapshotValue;
+    Snapshot(const char* data, size_t size, bool mapped) noexcept;
+    bool validate(std::string& errMsg, bool verifyChecksum);
+
+private:
+    const char* _data;
+    size_t _size;
+    bool _mapped;   //是否需要munmap
+    const SnapshotNode* _nodes = nullptr;
+    const uint64_t* _words = nullptr;
+    const char* _strings = nullptr;
+    uint64_t _nodeCount = 0;
+    uint64_t _wordCount = 0;
+    uint64_t _stringBytes = 0;
+};
+}//namespace LeptJson
@@ -0,0 +1,507 @@
+#pragma once
+
+#include<cstdint>
+#include<limits>
+#include<string_view>
+#include"json.h"
+#include"jsonException.h"
+#include"parse.h"
+
+namespace LeptJson
+{
+//编译期解析json字面量，得到只读的静态文档，运行时不再解析也不分配内存
+//static constexpr auto kConfig = LEPTJSON_LITERAL(R"({ "port" : 8080 })");
+//static_assert(kConfig.root()["port"].toNumber() == 8080);
+//语法错误在编译时报出，错误信息见编译器指向的staticError调用
+#define LEPTJSON_LITERAL(str)                                                        \
+    ([] {                                                                            \
+        constexpr auto kSize = LeptJson::detail::measureLiteral(str);                \
+        return LeptJson::StaticJson<kSize.nodes, kSize.chars>(str);                  \
+    }())
+
+//不是constexpr函数，编译期走到这里就是编译错误，运行时抛出JsonException
+[[noreturn]] inline void staticError(const char* msg)
+{
+    throw JsonException(msg);
+}
+
+//按先序排列的节点，容器的子节点紧跟在它后面
+struct StaticNode
+{
+    JsonType type = JsonType::kNull;
+    bool boolean = false;
+    double number = 0;
+    size_t begin = 0;       //字符串在字符池中的起点
+    size_t length = 0;      //字符串的长度，或容器的元素个数
+    size_t keyBegin = 0;    //作为对象成员时key在字符池中的位置
+    size_t keyLength = 0;
+    size_t next = 0;        //整个子树之后的下一个节点
+};
+
+//静态文档中一个值的只读视图，可以在常量表达式中使用
+class JsonView
+{
+public:
+    constexpr JsonView(const StaticNode* nodes, const char* chars, size_t index) noexcept
+        : _nodes(nodes), _chars(chars), _index(index){}
+
+public:
+    constexpr JsonType getType() const noexcept {return node().type;}
+    constexpr bool isNull() const noexcept {return getType() == JsonType::kNull;}
+    constexpr bool isBool() const noexcept {return getType() == JsonType::kBool;}
+    constexpr bool isNumber() const noexcept {return getType() == JsonType::kNumber;}
+    constexpr bool isString() const noexcept {return getType() == JsonType::kString;}
+    constexpr bool isArray() const noexcept {return getType() == JsonType::kArray;}
+    constexpr bool isObject() const noexcept {return getType() == JsonType::kObject;}
+
+public:
+    constexpr bool toBool() const
+    {
+        if(!isBool())
+            staticError("not a bool");
+        return node().boolean;
+    }
+    constexpr double toNumber() const
+    {
+        if(!isNumber())
+            staticError("not a number");
+        return node().number;
+    }
+    constexpr std::string_view toString() const
+    {
+        if(!isString())
+            staticError("not a string");
+        return {_chars + node().begin, node().length};
+    }
+
+public:
+    //数组和对象的接口，按下标和key查找都是线性的
+    constexpr size_t size() const
+    {
+        if(!isArray() && !isObject())
+            staticError("not a array or object");
+        return node().length;
+    }
+    constexpr JsonView operator[](size_t pos) const
+    {
+        if(pos >= size())
+            staticError("index out of range");
+        size_t index = _index + 1;
+        for(size_t i = 0; i < pos; i++)
+            index = _nodes[index].next;
+        return JsonView(_nodes, _chars, index);
+    }
+    //对象第pos个成员的key，顺序与字面量中一致
+    constexpr std::string_view key(size_t pos) const
+    {
+        if(!isObject())
+            staticError("not a object");
+        const StaticNode& member = _nodes[(*this)[pos]._index];
+        return {_chars + member.keyBegin, member.keyLength};
+    }
+    constexpr bool contains(std::string_view key) const
+    {
+        return find(key) != 0;
+    }
+    constexpr JsonView operator[](std::string_view key) const
+    {
+        size_t index = find(key);
+        if(index == 0)
+            staticError("key not found");
+        return JsonView(_nodes, _chars, index);
+    }
+
+public:
+    //运行时转成普通的Json
+    Json toJson() const;
+
+private:
+    constexpr const StaticNode& node() const noexcept {return _nodes[_index];}
+    //找到返回节点下标，找不到返回0，根节点不可能是成员
+    constexpr size_t find(std::string_view key) const
+    {
+        if(!isObject())
+            staticError("not a object");
+        size_t index = _index + 1;
+        for(size_t i = 0; i < node().length; i++)
+        {
+            const StaticNode& member = _nodes[index];
+            if(std::string_view(_chars + member.keyBegin, member.keyLength) == key)
+                return index;
+            index = member.next;
+        }
+        return 0;
+    }
+
+private:
+    const StaticNode* _nodes;
+    const char* _chars;
+    size_t _index;
+};
+
+namespace detail
+{
+//和parse.cpp相同的文法，递归下降，结果写进Sink
+template<class Sink>
+class LiteralParser
+{
+public:
+    constexpr LiteralParser(std::string_view text, Sink& sink) noexcept : _text(text), _sink(sink){}
+
+public:
+    constexpr void parse()
+    {
+        parseWhitespace();
+        parseValue(0, 0);
+        parseWhitespace();
+        if(_pos != _text.size())
+            staticError("ROOT NOT SINGULAR");
+    }
+
+private:
+    constexpr char peek() const noexcept {return _pos < _text.size() ? _text[_pos] : '\0';}
+
+    constexpr void parseWhitespace() noexcept
+    {
+        while(peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n')
+            _pos++;
+    }
+
+    constexpr void parseValue(size_t keyBegin, size_t keyLength)
+    {
+        StaticNode node;
+        node.keyBegin = keyBegin;
+        node.keyLength = keyLength;
+        switch(peek())
+        {
+            case 'n': parseLiteral("null"); break;
+            case 't': parseLiteral("true"); node.type = JsonType::kBool; node.boolean = true; break;
+            case 'f': parseLiteral("false"); node.type = JsonType::kBool; break;
+            case '"':
+                node.type = JsonType::kString;
+                parseString(node.begin, node.length);
+                break;
+            case '[':
+            case '{':
+                parseContainer(node);
+                return;
+            case '\0': staticError("EXPECT VALUE"); break;
+            default:
+                node.type = JsonType::kNumber;
+                node.number = parseNumber();
+                break;
+        }
+        size_t index = _sink.pushNode(node);
+        _sink.node(index).next = index + 1;
+    }
+
+    constexpr void parseContainer(StaticNode& node)
+    {
+        bool object = peek() == '{';
+        node.type = object ? JsonType::kObject : JsonType::kArray;
+        size_t index = _sink.pushNode(node);
+        size_t count = 0;
+        _pos++;
+        parseWhitespace();
+        if(peek() != (object ? '}' : ']'))
+        {
+            while(1)
+            {
+                size_t keyBegin = 0, keyLength = 0;
+                if(object)
+                {
+                    if(peek() != '"')
+                        staticError("MISS KEY");
+                    parseString(keyBegin, keyLength);
+                    parseWhitespace();
+                    if(peek() != ':')
+                        staticError("MISS COLON");
+                    _pos++;
+                    parseWhitespace();
+                }
+                parseValue(keyBegin, keyLength);
+                count++;
+                parseWhitespace();
+                if(peek() != ',')
+                    break;
+                _pos++;
+                parseWhitespace();
+            }
+            if(peek() != (object ? '}' : ']'))
+                staticError(object ? "MISS COMMA OR CURLY BRACKET" : "MISS COMMA OR SQUARE BRACKET");
+        }
+        _pos++;
+        _sink.node(index).length = count;
+        _sink.node(index).next = _sink.nodeCount();
+    }
+
+    constexpr void parseLiteral(std::string_view literal)
+    {
+        if(_text.substr(_pos, literal.size()) != literal)
+            staticError("INVALID VALUE");
+        _pos += literal.size();
+    }
+
+    constexpr unsigned parse4hex()
+    {
+        unsigned u = 0;
+        for(size_t i = 0; i < 4; i++)
+        {
+            char ch = peek();
+            _pos++;
+            u <<= 4;
+            if(is0to9(ch))
+                u |= ch - '0';
+            else if(ch >= 'A' && ch <= 'F')
+                u |= ch - 'A' + 10;
+            else if(ch >= 'a' && ch <= 'f')
+                u |= ch - 'a' + 10;
+            else
+                staticError("INVALID UNICODE HEX");
+        }
+        return u;
+    }
+
+    constexpr void encodeUTF8(unsigned u)
+    {
+        if(u <= 0x7F)
+        {
+            _sink.pushChar(static_cast<char>(u));
+        }
+        else if(u <= 0x7FF)
+        {
+            _sink.pushChar(static_cast<char>(0xC0 | (u >> 6)));
+            _sink.pushChar(static_cast<char>(0x80 | (u & 0x3F)));
+        }
+        else if(u <= 0xFFFF)
+        {
+            _sink.pushChar(static_cast<char>(0xE0 | (u >> 12)));
+            _sink.pushChar(static_cast<char>(0x80 | ((u >> 6) & 0x3F)));
+            _sink.pushChar(static_cast<char>(0x80 | (u & 0x3F)));
+        }
+        else
+        {
+            _sink.pushChar(static_cast<char>(0xF0 | (u >> 18)));
+            _sink.pushChar(static_cast<char>(0x80 | ((u >> 12) & 0x3F)));
+            _sink.pushChar(static_cast<char>(0x80 | ((u >> 6) & 0x3F)));
+            _sink.pushChar(static_cast<char>(0x80 | (u & 0x3F)));
+        }
+    }
+
+    constexpr void parseString(size_t& begin, size_t& length)
+    {
+        begin = _sink.charCount();
+        _pos++;
+        while(1)
+        {
+            if(_pos >= _text.size())
+                staticError("MISS QUOTATION MARK");
+            char ch = _text[_pos++];
+            if(ch == '"')
+                break;
+            if(static_cast<unsigned char>(ch) < 0x20)
+                staticError("INVALID STRING CHAR");
+            if(ch != '\\')
+            {
+                _sink.pushChar(ch);
+                continue;
+            }
+            switch(peek())
+            {
+                case '"': _sink.pushChar('"'); break;
+                case '\\': _sink.pushChar('\\'); break;
+                case '/': _sink.pushChar('/'); break;
+                case 'b': _sink.pushChar('\b'); break;
+                case 'f': _sink.pushChar('\f'); break;
+                case 'n': _sink.pushChar('\n'); break;
+                case 'r': _sink.pushChar('\r'); break;
+                case 't': _sink.pushChar('\t'); break;
+                case 'u':
+                {
+                    _pos++;
+                    unsigned u = parse4hex();
+                    if(u >= 0xD800 && u <= 0xDBFF)
+                    {
+                        if(peek() != '\\' || _text.substr(_pos + 1, 1) != "u")
+                            staticError("INVALID UNICODE SURROGATE");
+                        _pos += 2;
+                        unsigned low = parse4hex();
+                        if(low < 0xDC00 || low > 0xDFFF)
+                            staticError("INVALID UNICODE SURROGATE");
+                        u = (((u - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+                    }
+                    encodeUTF8(u);
+                    continue;
+                }
+                default: staticError("INVALID STRING ESCAPE");
+            }
+            _pos++;
+        }
+        length = _sink.charCount() - begin;
+    }
+
+    //最多保留19位有效数字，尾数不超过2^53且指数在±22以内时结果精确
+    //其余情况用long double缩放，极少数情况下可能和运行时的strtod差一个ulp
+    constexpr double parseNumber()
+    {
+        bool negative = false;
+        uint64_t mantissa = 0;
+        int digits = 0;
+        long exp10 = 0;
+        auto digit = [&](int d, bool fraction) {
+            if(digits < 19)
+            {
+                mantissa = mantissa * 10 + d;
+                if(mantissa)
+                    digits++;
+                if(fraction)
+                    exp10--;
+            }
+            else if(!fraction)
+            {
+                exp10++;
+            }
+        };
+        if(peek() == '-')
+        {
+            negative = true;
+            _pos++;
+        }
+        if(peek() == '0')
+        {
+            _pos++;
+        }
+        else
+        {
+            if(!is1to9(peek()))
+                staticError("INVALID VALUE");
+            while(is0to9(peek()))
+                digit(_text[_pos++] - '0', false);
+        }
+        if(peek() == '.')
+        {
+            _pos++;
+            if(!is0to9(peek()))
+                staticError("INVALID VALUE");
+            while(is0to9(peek()))
+                digit(_text[_pos++] - '0', true);
+        }
+        if(peek() == 'e' || peek() == 'E')
+        {
+            _pos++;
+            bool minus = false;
+            if(peek() == '+' || peek() == '-')
+                minus = _text[_pos++] == '-';
+            if(!is0to9(peek()))
+                staticError("INVALID VALUE");
+            long e = 0;
+            while(is0to9(peek()))
+            {
+                if(e < 100000)
+                    e = e * 10 + (_text[_pos] - '0');
+                _pos++;
+            }
+            exp10 += minus ? -e : e;
+        }
+        double val = toDouble(mantissa, exp10);
+        if(val > std::numeric_limits<double>::max())
+            staticError("NUMBER TOO BIG");
+        return negative ? -val : val;
+    }
+
+    static constexpr double toDouble(uint64_t mantissa, long exp10)
+    {
+        if(mantissa == 0 || exp10 < -400)
+            return 0;
+        //最多19位尾数，指数再大一定超出double的范围，由调用方报错
+        if(exp10 > 330)
+            return std::numeric_limits<double>::infinity();
+        if(mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22)
+        {
+            double scale = 1;
+            for(long i = 0; i < (exp10 < 0 ? -exp10 : exp10); i++)
+                scale *= 10;
+            return exp10 < 0 ? mantissa / scale : mantissa * scale;
+        }
+        long double val = mantissa;
+        long double base = 10;
+        for(long e = exp10 < 0 ? -exp10 : exp10; e > 0; e >>= 1)
+        {
+            if(e & 1)
+                val = exp10 < 0 ? val / base : val * base;
+            base *= base;
+        }
+        if(val > std::numeric_limits<double>::max())
+            return std::numeric_limits<double>::infinity();
+        return static_cast<double>(val);
+    }
+
+private:
+    std::string_view _text;
+    Sink& _sink;
+    size_t _pos = 0;
+};
+
+//第一遍只计数，得到节点和字符池需要的容量
+struct LiteralSize
+{
+    size_t nodes = 0;
+    size_t chars = 0;
+    StaticNode dummy;
+
+    constexpr size_t pushNode(const StaticNode&) noexcept {return nodes++;}
+    constexpr StaticNode& node(size_t) noexcept {return dummy;}
+    constexpr size_t nodeCount() const noexcept {return nodes;}
+    constexpr void pushChar(char) noexcept {chars++;}
+    constexpr size_t charCount() const noexcept {return chars;}
+};
+
+constexpr LiteralSize measureLiteral(std::string_view text)
+{
+    LiteralSize size;
+    LiteralParser<LiteralSize>(text, size).parse();
+    return size;
+}
+}//namespace detail
+
+//容量固定的静态文档，kNodes和kChars由LEPTJSON_LITERAL计算
+template<size_t kNodes, size_t kChars>
+class StaticJson
+{
+public:
+    constexpr explicit StaticJson(std::string_view text)
+    {
+        detail::LiteralParser<StaticJson>(text, *this).parse();
+    }
+
+public:
+    constexpr JsonView root() const noexcept {return JsonView(_nodes, _chars, 0);}
+    Json toJson() const {return root().toJson();}
+
+private:
+    friend class detail::LiteralParser<StaticJson>;
+
+    constexpr size_t pushNode(const StaticNode& node)
+    {
+        if(_nodeCount >= kNodes)
+            staticError("CAPACITY EXCEEDED");
+        _nodes[_nodeCount] = node;
+        return _nodeCount++;
+    }
+    constexpr StaticNode& node(size_t index) noexcept {return _nodes[index];}
+    constexpr size_t nodeCount() const noexcept {return _nodeCount;}
+    constexpr void pushChar(char ch)
+    {
+        if(_charCount >= kChars)
+            staticError("CAPACITY EXCEEDED");
+        _chars[_charCount++] = ch;
+    }
+    constexpr size_t charCount() const noexcept {return _charCount;}
+
+private:
+    StaticNode _nodes[kNodes ? kNodes : 1] = {};
+    char _chars[kChars ? kChars : 1] = {};
+    size_t _nodeCount = 0;
+    size_t _charCount = 0;
+};
+}//namespace LeptJson
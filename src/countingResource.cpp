@@ -0,0 +1,29 @@
+#include"countingResource.h"
+
+namespace LeptJson
+{
+void* CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void* p = _upstream->allocate(bytes, alignment);
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+    _totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+    size_t inUse = _bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    //更新峰值，失败时peak已被其他线程更新，重新比较
+    size_t peak = _peakBytes.load(std::memory_order_relaxed);
+    while(inUse > peak && !_peakBytes.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+        ;
+    return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    _upstream->deallocate(p, bytes, alignment);
+    _deallocations.fetch_add(1, std::memory_order_relaxed);
+    _bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+}//namespace LeptJson
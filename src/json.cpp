@@ -1,38 +1,138 @@
+#include<algorithm>
+#include<array>
+#include<atomic>
+#include<charconv>
 #include<cstdio>
+#include<stdexcept>
+#include<unordered_set>
 #include"json.h"
+#include"jsonException.h"
 #include"jsonValue.h"
+#include"jsonWriter.h"
 #include"parse.h"
+#include"scan.h"
 
 namespace LeptJson
 {
-//构造函数，用make_unique为jsonvalue初始化
-Json::Json(std::nullptr_t) : _jsonValue(std::make_unique<JsonValue>(nullptr)){}
-Json::Json(bool val) : _jsonValue(std::make_unique<JsonValue>(val)){}    
-Json::Json(double val) : _jsonValue(std::make_unique<JsonValue>(val)){}
-Json::Json(const std::string& val) : _jsonValue(std::make_unique<JsonValue>(val)){}
-Json::Json(const _array& val) : _jsonValue(std::make_unique<JsonValue>(val)){}
-Json::Json(const _object& val) : _jsonValue(std::make_unique<JsonValue>(val)){}
+//构造函数，用make_shared为jsonvalue初始化
+Json::Json(std::nullptr_t) : _jsonValue(std::make_shared<JsonValue>(nullptr)){}
+Json::Json(bool val) : _jsonValue(std::make_shared<JsonValue>(val)){}    
+Json::Json(double val) : _jsonValue(std::make_shared<JsonValue>(val)){}
+Json::Json(const std::string& val) : _jsonValue(std::make_shared<JsonValue>(val)){}
+Json::Json(const _array& val) : _jsonValue(std::make_shared<JsonValue>(val)){}
+Json::Json(const _object& val) : _jsonValue(std::make_shared<JsonValue>(val)){}
 
 //移动构造
-Json::Json(std::string&& val) : _jsonValue(std::make_unique<JsonValue>(std::move(val))){}
-Json::Json(_array&& val) : _jsonValue(std::make_unique<JsonValue>(std::move(val))){}
-Json::Json(_object&& val) : _jsonValue(std::make_unique<JsonValue>(std::move(val))){}
+Json::Json(std::string&& val) : _jsonValue(std::make_shared<JsonValue>(std::move(val))){}
+//移进来的子节点可能交出过可变引用，和push_back()一样要标记容器
+Json::Json(_array&& val) : _jsonValue(std::make_shared<JsonValue>(std::move(val)))
+{
+    for(auto& child : *_jsonValue->getArray())
+        adopt(child);
+}
+Json::Json(_object&& val) : _jsonValue(std::make_shared<JsonValue>(std::move(val)))
+{
+    for(auto& [key, child] : *_jsonValue->getObject())
+        adopt(child);
+}
+
+//在resource上构造节点，控制块和JsonValue一起分配
+template<class... Args>
+static std::shared_ptr<JsonValue> makeValue(std::pmr::memory_resource* resource, Args&&... args)
+{
+    if(!resource)
+        return std::make_shared<JsonValue>(std::forward<Args>(args)...);
+    return std::allocate_shared<JsonValue>(std::pmr::polymorphic_allocator<JsonValue>(resource),
+                                           std::forward<Args>(args)...);
+}
+
+//指定memory_resource的构造
+Json::Json(std::nullptr_t, std::pmr::memory_resource* resource) : _jsonValue(makeValue(resource, nullptr)){}
+Json::Json(bool val, std::pmr::memory_resource* resource) : _jsonValue(makeValue(resource, val)){}
+Json::Json(double val, std::pmr::memory_resource* resource) : _jsonValue(makeValue(resource, val)){}
+Json::Json(std::string val, std::pmr::memory_resource* resource) : _jsonValue(makeValue(resource, std::move(val))){}
+//容器换到resource上，分配器相同时直接移动，否则逐个移动元素
+Json::Json(_array val, std::pmr::memory_resource* resource)
+    : _jsonValue(resource ? makeValue(resource, _array(std::move(val), resource))
+                          : makeValue(resource, std::move(val))){}
+Json::Json(_object val, std::pmr::memory_resource* resource)
+    : _jsonValue(resource ? makeValue(resource, _object(std::move(val), resource))
+                          : makeValue(resource, std::move(val))){}
+
+//resource和数值缓冲区的不同时先把数值换到resource上
+Json Json::fromNumbers(std::pmr::vector<double> values, std::pmr::memory_resource* resource)
+{
+    if(resource && values.get_allocator().resource() != resource)
+        values = std::pmr::vector<double>(values.begin(), values.end(), resource);
+    return Json(makeValue(resource, std::move(values)));
+}
+
+//析构，独占的容器子节点先摘下来放进显式栈，逐层释放，避免深层嵌套时递归析构栈溢出
+//被其他Json共享的子树引用计数不会归零，留给最后一个持有者释放
+Json::~Json()
+{
+    if(_jsonValue.use_count() != 1 || (!_jsonValue->getArray() && !_jsonValue->getObject()))
+        return;
+    std::vector<std::shared_ptr<JsonValue>> stack;
+    stack.push_back(std::move(_jsonValue));
+    while(!stack.empty())
+    {
+        std::shared_ptr<JsonValue> node = std::move(stack.back());
+        stack.pop_back();
+        auto steal = [&stack](Json& child) {
+            if(child._jsonValue.use_count() == 1 && (child._jsonValue->getArray() || child._jsonValue->getObject()))
+                stack.push_back(std::move(child._jsonValue));
+        };
+        if(auto arr = node->getArray())
+            for(auto& e : *arr)
+                steal(e);
+        else if(auto obj = node->getObject())
+            for(auto& it : *obj)
+                steal(it.second);
+    }
+}
 
-//析构
-Json::~Json() = default;
+//正在unshare()时为true，这期间拷贝容器产生的子节点拷贝先共享，由unshare()逐个处理
+static thread_local bool tUnsharing = false;
 
-//拷贝构造
-Json::Json(const Json& rhs)
+//拷贝构造，共享同一个节点，真正的复制推迟到修改时
+//节点交出过可变引用时不能共享，立即复制
+Json::Json(const Json& rhs) : _jsonValue(rhs._jsonValue)
 {
-    switch(rhs.getType())
+    if(_jsonValue && _jsonValue->unshareable() && !tUnsharing)
+        unshare();
+}
+
+//复制不能共享的节点，子节点中同样不能共享的继续复制，其余的子节点共享
+//用显式栈代替递归，交出过引用的路径可能很深
+void Json::unshare()
+{
+    struct Guard
+    {
+        Guard() {tUnsharing = true;}
+        ~Guard() {tUnsharing = false;}
+    } guard;
+    //节点复制到原来的resource上，标量看不出resource，沿用父容器的
+    std::vector<std::pair<Json*, std::pmr::memory_resource*>> stack{{this, nullptr}};
+    while(!stack.empty())
     {
-        case JsonType::kNull : _jsonValue = std::make_unique<JsonValue>(nullptr);break;
-        case JsonType::kBool : _jsonValue = std::make_unique<JsonValue>(rhs.toBool());break;
-        case JsonType::kNumber : _jsonValue = std::make_unique<JsonValue>(rhs.toNumber());break;
-        case JsonType::kString : _jsonValue = std::make_unique<JsonValue>(rhs.toString());break;
-        case JsonType::kArray : _jsonValue = std::make_unique<JsonValue>(rhs.toArray());break;
-        case JsonType::kObject : _jsonValue = std::make_unique<JsonValue>(rhs.toObject());break;
-        default : break;
+        auto [json, resource] = stack.back();
+        stack.pop_back();
+        if(auto own = json->_jsonValue->resource())
+            resource = own;
+        json->_jsonValue = makeValue(resource, *json->_jsonValue, resource);
+        if(auto arr = json->_jsonValue->getArray())
+        {
+            for(auto& e : *arr)
+                if(e._jsonValue && e._jsonValue->unshareable())
+                    stack.emplace_back(&e, resource);
+        }
+        else if(auto obj = json->_jsonValue->getObject())
+        {
+            for(auto& it : *obj)
+                if(it.second._jsonValue && it.second._jsonValue->unshareable())
+                    stack.emplace_back(&it.second, resource);
+        }
     }
 }
 
@@ -63,26 +163,52 @@ Json Json::parse(const std::string& content, std::string& errMsg) noexcept
     }
 }
 
-//序列化，json->string
-std::string Json::serialize() const noexcept
+Json Json::parse(const std::string& content, std::string& errMsg, const ParseOptions& options) noexcept
 {
-    switch(_jsonValue->getType())
+    try
     {
-        case JsonType::kNull: 
-            return "null";
-        case JsonType::kBool: 
-            return _jsonValue->toBool() ? "true" : "false";
-        case JsonType::kNumber: 
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%.17g", _jsonValue->toNumber());
-            return std::string(buffer);
-        case JsonType::kString:
-            return serializeString();
-        case JsonType::kArray:
-            return serializeArray();
-        default:
-            return serializeObject();
+        Parser p(content, options);
+        return p.parse();
     }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+}
+
+bool Json::parseInto(Json& target, const std::string& content, std::string& errMsg,
+                     const ParseOptions& options) noexcept
+{
+    try
+    {
+        NodePool pool;
+        if(!options.resource)
+            pool.collect(target);
+        Parser p(content, options);
+        p.reuse(&pool);
+        target = p.parse();
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        target = Json(nullptr);
+        return false;
+    }
+}
+
+//序列化，json->string
+std::string Json::serialize() const noexcept
+{
+    return serialize(SerializeOptions());
+}
+
+std::string Json::serialize(const SerializeOptions& options) const noexcept
+{
+    std::string res;
+    serializeTo(res, options);
+    return res;
 }
 
 //类型获取接口
@@ -125,6 +251,15 @@ double Json::toNumber() const
 {
     return _jsonValue->toNumber();
 }
+int64_t Json::toInt64() const
+{
+    return _jsonValue->toInt64();
+}
+const std::string* Json::rawNumber() const noexcept
+{
+    auto raw = _jsonValue->getRawNumber();
+    return raw ? &raw->text : nullptr;
+}
 const std::string& Json::toString() const
 {
     return _jsonValue->toString();
@@ -138,6 +273,104 @@ const Json::_object& Json::toObject() const
     return _jsonValue->toObject();
 }
 
+//字符串超出SSO缓冲区时才在堆上分配
+static size_t heapBytes(const std::string& str) noexcept
+{
+    const char* self = reinterpret_cast<const char*>(&str);
+    if(str.data() >= self && str.data() < self + sizeof(str))
+        return 0;
+    return str.capacity() + 1;
+}
+
+//用显式栈遍历，记录访问过的节点，共享的子树只统计一次
+MemoryUsage Json::memoryUsage() const
+{
+    //make_shared的控制块放在节点前面，包含两个引用计数和虚表指针
+    constexpr size_t kControlBlockBytes = 2 * sizeof(int) + sizeof(void*);
+    //哈希表节点包含next指针和缓存的哈希值
+    constexpr size_t kHashNodeBytes = sizeof(Json::_object::value_type) + sizeof(void*) + sizeof(size_t);
+
+    MemoryUsage usage;
+    std::unordered_set<const JsonValue*> visited;
+    std::vector<const Json*> stack{this};
+    while(!stack.empty())
+    {
+        const Json* json = stack.back();
+        stack.pop_back();
+        if(!visited.insert(json->_jsonValue.get()).second)
+            continue;
+        usage.nodes++;
+        usage.nodeBytes += sizeof(JsonValue) + kControlBlockBytes;
+        if(auto fragment = json->_jsonValue->fragment())
+            usage.fragmentBytes += sizeof(SerializedFragment) + heapBytes(fragment->text);
+        if(auto packed = json->_jsonValue->getPacked())
+        {
+            //紧凑数组只计数值缓冲区，已经构造过的元素另外计入
+            usage.arrays++;
+            usage.containerBytes += packed->doubles.capacity() * sizeof(double)
+                                  + packed->ints.capacity() * sizeof(int64_t);
+            if(auto elements = packed->materialized())
+            {
+                usage.containerBytes += elements->capacity() * sizeof(Json);
+                for(auto& e : *elements)
+                    stack.push_back(&e);
+            }
+            continue;
+        }
+        switch(json->getType())
+        {
+            case JsonType::kString:
+                usage.strings++;
+                usage.stringBytes += heapBytes(json->toString());
+                break;
+            case JsonType::kArray:
+                usage.arrays++;
+                usage.containerBytes += json->toArray().capacity() * sizeof(Json);
+                for(auto& e : json->toArray())
+                    stack.push_back(&e);
+                break;
+            case JsonType::kObject:
+                usage.objects++;
+                usage.containerBytes += json->toObject().bucket_count() * sizeof(void*)
+                                      + json->toObject().size() * kHashNodeBytes;
+                for(auto& it : json->toObject())
+                {
+                    usage.stringBytes += heapBytes(it.first);
+                    stack.push_back(&it.second);
+                }
+                break;
+            case JsonType::kNumber:
+                if(auto raw = json->rawNumber())
+                    usage.stringBytes += heapBytes(*raw);
+                break;
+            default:
+                break;
+        }
+    }
+    return usage;
+}
+
+bool Json::isPacked() const noexcept
+{
+    return _jsonValue->getPacked() != nullptr;
+}
+
+Span<double> Json::packedDoubles() const noexcept
+{
+    auto packed = _jsonValue->getPacked();
+    if(!packed || packed->integral)
+        return {};
+    return {packed->doubles.data(), packed->doubles.size()};
+}
+
+Span<int64_t> Json::packedInts() const noexcept
+{
+    auto packed = _jsonValue->getPacked();
+    if(!packed || !packed->integral)
+        return {};
+    return {packed->ints.data(), packed->ints.size()};
+}
+
 //数组和对象的[]接口
 size_t Json::size() const
 {
@@ -145,6 +378,8 @@ size_t Json::size() const
 }
 Json& Json::operator[](size_t pos)
 {
+    detach();
+    markUnshareable();
     return _jsonValue->operator[](pos);
 }
 const Json& Json::operator[](size_t pos) const
@@ -153,13 +388,109 @@ const Json& Json::operator[](size_t pos) const
 }
 Json& Json::operator[](const std::string& key)
 {
-    return _jsonValue->operator[](key);
+    _object& obj = mutableObject();
+    markUnshareable();
+    return obj[key];
 }
 const Json& Json::operator[](const std::string& key) const
 {
     return _jsonValue->operator[](key);
 }
 
+void Json::markUnshareable() noexcept
+{
+    _jsonValue->markUnshareable();
+}
+
+//移进来的节点可能还有可变引用指向它，容器也就不能再共享
+void Json::adopt(const Json& child) noexcept
+{
+    if(child._jsonValue && child._jsonValue->unshareable())
+        markUnshareable();
+}
+
+void Json::push_back(Json val)
+{
+    _array& arr = mutableArray();
+    adopt(val);
+    arr.push_back(std::move(val));
+}
+
+void Json::reserve(size_t n)
+{
+    detach();
+    if(auto arr = _jsonValue->getArray())
+        arr->reserve(n);
+    else if(auto obj = _jsonValue->getObject())
+        obj->reserve(n);
+    else
+        throw JsonException("not a array or object");
+}
+
+void Json::insert(size_t pos, Json val)
+{
+    _array& arr = mutableArray();
+    if(pos > arr.size())
+        throw std::out_of_range("insert position out of range");
+    adopt(val);
+    arr.insert(arr.begin() + pos, std::move(val));
+}
+
+bool Json::insert(const std::string& key, Json val)
+{
+    _object& obj = mutableObject();
+    adopt(val);
+    return obj.try_emplace(key, std::move(val)).second;
+}
+
+Json& Json::set(const std::string& key, Json val)
+{
+    _object& obj = mutableObject();
+    markUnshareable();
+    return obj.insert_or_assign(key, std::move(val)).first->second;
+}
+
+void Json::erase(size_t pos)
+{
+    _array& arr = mutableArray();
+    if(pos >= arr.size())
+        throw std::out_of_range("erase position out of range");
+    arr.erase(arr.begin() + pos);
+}
+
+size_t Json::erase(const std::string& key)
+{
+    return mutableObject().erase(key);
+}
+
+void Json::clear()
+{
+    detach();
+    if(auto arr = _jsonValue->getArray())
+        arr->clear();
+    else if(auto obj = _jsonValue->getObject())
+        obj->clear();
+    else
+        throw JsonException("not a array or object");
+}
+
+//独占节点后返回可修改的容器
+Json::_array& Json::mutableArray()
+{
+    detach();
+    if(auto arr = _jsonValue->getArray())
+        return *arr;
+    throw JsonException("not a array");
+}
+
+Json::_object& Json::mutableObject()
+{
+    detach();
+    if(auto obj = _jsonValue->getObject())
+        return *obj;
+    throw JsonException("not a object");
+}
+
 //用于拷贝赋值的copy and swap
 void Json::swap(Json& rhs) noexcept
 {
@@ -167,85 +498,346 @@ void Json::swap(Json& rhs) noexcept
     swap(_jsonValue, rhs._jsonValue);
 }
 
-//序列化字符串，带/和“的字符需要转义
-std::string Json::serializeString() const noexcept
+//写时复制，节点被共享时复制一份自己独占
+//容器只复制一层，子节点仍然共享，等到沿路径修改时再各自复制
+//引用计数为1时需要acquire，保证其他线程释放前对节点的读取已经完成
+//独占的节点会被原地修改，缓存的哈希和序列化结果随之失效，紧凑数组展开后再修改
+void Json::detach()
+{
+    if(_jsonValue.use_count() > 1)
+    {
+        //复制到原来的resource上，不离开调用者的内存池
+        std::pmr::memory_resource* resource = _jsonValue->resource();
+        _jsonValue = makeValue(resource, *_jsonValue, resource);
+    }
+    else
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        _jsonValue->resetCache();
+    }
+    //紧凑数组修改前展开成普通数组
+    _jsonValue->unpack();
+}
+
+//转义表，0表示不需要转义，'u'表示输出\u00XX，其余为反斜杠后面的字符
+static constexpr std::array<char, 128> kEscapeTable = [] {
+    std::array<char, 128> table{};
+    for(int i = 0; i < 0x20; i++)
+        table[i] = 'u';
+    table['"'] = '"';
+    table['\\'] = '\\';
+    table['/'] = '/';
+    table['\b'] = 'b';
+    table['\f'] = 'f';
+    table['\n'] = 'n';
+    table['\r'] = 'r';
+    table['\t'] = 't';
+    return table;
+}();
+
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+static void appendUnicodeEscape(std::string& res, unsigned u)
+{
+    char buffer[6] = {'\\', 'u', kHexDigits[(u >> 12) & 0xF], kHexDigits[(u >> 8) & 0xF],
+                      kHexDigits[(u >> 4) & 0xF], kHexDigits[u & 0xF]};
+    res.append(buffer, sizeof(buffer));
+}
+
+//解码一个UTF-8序列，返回码点并移动p，非法序列只吃掉一个字节并返回U+FFFD
+static unsigned decodeUTF8(const char*& p, const char* end)
 {
-    std::string res = "\"";
-    for(auto e : _jsonValue->toString())
+    auto ch = static_cast<unsigned char>(*p);
+    size_t len = ch >= 0xF0 ? 4 : ch >= 0xE0 ? 3 : 2;
+    if(static_cast<size_t>(end - p) < len || !isValidUtf8(p, p + len))
+    {
+        p++;
+        return 0xFFFD;
+    }
+    unsigned u = ch & (0x7F >> len);
+    for(size_t i = 1; i < len; i++)
+        u = (u << 6) | (static_cast<unsigned char>(p[i]) & 0x3F);
+    p += len;
+    return u;
+}
+
+//转义字符串并加上引号
+//不需要转义的字符成段扫描后整段追加，只在需要转义的字符处查表
+void Json::escapeString(const std::string& str, std::string& res, const SerializeOptions& options) noexcept
+{
+    res.reserve(res.size() + str.size() + 2);
+    res += '"';
+    const char* p = str.data();
+    const char* end = p + str.size();
+    while(1)
     {
-        switch(e)
+        const char* run = p;
+        p = scanEscapeRun(p, end, options.escapeUnicode, options.escapeSlash);
+        res.append(run, p);
+        if(p == end)
+            break;
+        auto ch = static_cast<unsigned char>(*p);
+        if(ch >= 0x80)
         {
-            //需加/转义的几种字符
-            case '\"' : res += "\\\"";break;
-            case '\\' : res += "\\\\";break;
-            case '\b' : res += "\\b";break;
-            case '\f' : res += "\\f";break;
-            case '\n' : res += "\\n";break;
-            case '\r' : res += "\\r";break;
-            case '\t' : res += "\\t";break;
-            default:
-                if(static_cast<unsigned char>(e) < 0x20)//前缀加u的字符
-                {
-                    char buffer[7];
-                    sprintf(buffer, "\\u%04X", e);
-                    res += buffer;
-                }
-                else    //普通字符
-                {
-                    res += e;
-                }
+            //码点超出BMP时写成代理对
+            unsigned u = decodeUTF8(p, end);
+            if(u > 0xFFFF)
+            {
+                u -= 0x10000;
+                appendUnicodeEscape(res, 0xD800 | (u >> 10));
+                appendUnicodeEscape(res, 0xDC00 | (u & 0x3FF));
+            }
+            else
+            {
+                appendUnicodeEscape(res, u);
+            }
+            continue;
+        }
+        if(kEscapeTable[ch] == 'u')
+        {
+            appendUnicodeEscape(res, ch);
+        }
+        else
+        {
+            res += '\\';
+            res += kEscapeTable[ch];
         }
+        p++;
     }
     res += '"';
-    return res;
 }
 
-//序列化数组，每个元素单独调用serialize()
-std::string Json::serializeArray() const noexcept
+//数字统一按17位有效数字输出，保证往返一致
+void Json::formatNumber(double val, std::string& res) noexcept
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", val);
+    res += buffer;
+}
+
+//序列化标量，容器由serializeTo()处理
+void Json::serializeScalar(std::string& res, const SerializeOptions& options) const noexcept
 {
-    std::string res = "[ ";
-    for(size_t i = 0; i < _jsonValue->size(); i++)
+    switch(_jsonValue->getType())
+    {
+        case JsonType::kNull:
+            res += "null";
+            break;
+        case JsonType::kBool:
+            res += _jsonValue->toBool() ? "true" : "false";
+            break;
+        case JsonType::kNumber:
+            if(auto raw = _jsonValue->getRawNumber())
+                res += raw->text;
+            else
+                formatNumber(_jsonValue->toNumber(), res);
+            break;
+        default:
+            escapeString(_jsonValue->toString(), res, options);
+            break;
+    }
+}
+
+//紧凑数组不经过元素节点，整数直接用to_chars
+//每写完一个元素调用一次afterElement，写到JsonWriter时用它把满了的缓冲区交出去
+template<class F>
+static void writePacked(const PackedNumbers& packed, std::string& res, F&& afterElement)
+{
+    res += "[ ";
+    for(size_t i = 0; i < packed.size(); i++)
     {
         if(i > 0)
             res += " , ";
-        res += (*this)[i].serialize();
-    }    
+        if(packed.integral)
+        {
+            char buffer[24];
+            res.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), packed.ints[i]).ptr);
+        }
+        else
+        {
+            Json::formatNumber(packed.doubles[i], res);
+        }
+        afterElement();
+    }
     res += " ]";
-    return res;
 }
 
-//序列化对象，每个value单独调用serialize()
-std::string Json::serializeObject() const noexcept
+//比这短的容器重新格式化也很快，不值得为它分配缓存
+static constexpr size_t kMinFragmentBytes = 64;
+
+//节点有同样选项生成的缓存时返回它，直接拼接
+static const SerializedFragment* usableFragment(const JsonValue& node, const SerializeOptions& options)
+{
+    const SerializedFragment* fragment = node.fragment();
+    if(!fragment || fragment->escapeUnicode != options.escapeUnicode || fragment->escapeSlash != options.escapeSlash)
+        return nullptr;
+    return fragment;
+}
+
+//节点的序列化结果是res中begin之后的部分
+static void storeFragment(const JsonValue& node, const SerializeOptions& options, const std::string& res, size_t begin)
+{
+    if(res.size() - begin < kMinFragmentBytes)
+        return;
+    node.cacheFragment(std::make_unique<SerializedFragment>(
+        SerializedFragment{res.substr(begin), options.escapeUnicode, options.escapeSlash}));
+}
+
+//用显式栈代替递归，所有内容追加到同一个字符串上
+//数组元素用" , "分隔，对象写成{ "key" : value }的形式
+//写到sink时res会被中途清空，容器的结果不完整，只拼接已有的缓存
+void Json::serializeTo(std::string& res, const SerializeOptions& options, JsonWriter* sink) const
 {
-    std::string res = "{ ";
-    bool first = true;
-    for(auto&& it : _jsonValue->toObject())
+    struct Frame
+    {
+        const Json* json;
+        size_t index;
+        _object::const_iterator it;
+        size_t begin;   //容器在res中开始的位置
+    };
+    const bool record = options.cacheFragments && !sink;
+    auto spillFull = [&] {
+        if(sink && res.size() >= sink->_bufferSize)
+            sink->spill();
+    };
+    std::vector<Frame> stack;
+    const Json* next = this;
+    while(1)
     {
-        if(first)
-            first = false;
+        //写出一个值，容器写开头后入栈，紧凑数组直接在这里写完
+        const SerializedFragment* fragment = options.cacheFragments ? usableFragment(*next->_jsonValue, options) : nullptr;
+        if(fragment)
+        {
+            //没有修改过的子树整段拼接，写到sink时分块交出，缓冲区不会涨到整棵子树的大小
+            if(sink)
+                sink->spill(fragment->text.data(), fragment->text.size());
+            else
+                res += fragment->text;
+        }
+        else if(auto packed = next->_jsonValue->getPacked())
+        {
+            size_t begin = res.size();
+            writePacked(*packed, res, spillFull);
+            if(record)
+                storeFragment(*next->_jsonValue, options, res, begin);
+        }
+        else if(next->isArray())
+        {
+            stack.push_back({next, 0, {}, res.size()});
+            res += "[ ";
+        }
+        else if(next->isObject())
+        {
+            stack.push_back({next, 0, next->toObject().begin(), res.size()});
+            res += "{ ";
+        }
         else
-            res += " , ";
-        res += "\"" + it.first + "\"";
-        res += " : ";
-        res += it.second.serialize();
+        {
+            next->serializeScalar(res, options);
+        }
+        spillFull();
+        //找到下一个要写的值，写完的容器出栈
+        next = nullptr;
+        while(!next && !stack.empty())
+        {
+            Frame& top = stack.back();
+            if(top.json->isArray())
+            {
+                if(top.index == top.json->size())
+                {
+                    res += " ]";
+                    if(record)
+                        storeFragment(*top.json->_jsonValue, options, res, top.begin);
+                    stack.pop_back();
+                    continue;
+                }
+                if(top.index > 0)
+                    res += " , ";
+                next = &(*top.json)[top.index++];
+            }
+            else
+            {
+                if(top.it == top.json->toObject().end())
+                {
+                    res += " }";
+                    if(record)
+                        storeFragment(*top.json->_jsonValue, options, res, top.begin);
+                    stack.pop_back();
+                    continue;
+                }
+                if(top.index++ > 0)
+                    res += " , ";
+                escapeString(top.it->first, res, options);
+                res += " : ";
+                next = &top.it->second;
+                ++top.it;
+            }
+        }
+        if(!next)
+            return;
     }
-    res += " }";
-    return res;
 }
 
+//用显式栈逐对比较，共享同一个节点的子树直接视为相等，缓存的哈希不同时直接返回
 bool operator==(const Json& lhs, const Json& rhs)
 {
-    if(lhs.getType() != rhs.getType())
-        return false;
-    switch(lhs.getType())
+    std::vector<std::pair<const Json*, const Json*>> stack{{&lhs, &rhs}};
+    while(!stack.empty())
     {
-        case JsonType::kNull: return true;
-        case JsonType::kBool: return lhs.toBool() == rhs.toBool();
-        case JsonType::kNumber: return lhs.toNumber() == rhs.toNumber();
-        case JsonType::kString: return lhs.toString() == rhs.toString();
-        case JsonType::kArray: return lhs.toArray() == rhs.toArray();
-        case JsonType::kObject: return lhs.toObject() == rhs.toObject();
-        default: return false;
+        const Json& l = *stack.back().first;
+        const Json& r = *stack.back().second;
+        stack.pop_back();
+        if(l._jsonValue == r._jsonValue)
+            continue;
+        if(l.getType() != r.getType())
+            return false;
+        //两边都是紧凑数组时直接比较数值
+        auto lpacked = l._jsonValue->getPacked();
+        auto rpacked = r._jsonValue->getPacked();
+        if(lpacked && rpacked)
+        {
+            if(lpacked->size() != rpacked->size())
+                return false;
+            for(size_t i = 0; i < lpacked->size(); i++)
+                if(lpacked->at(i) != rpacked->at(i))
+                    return false;
+            continue;
+        }
+        //两边都算过哈希时，哈希不同一定不相等
+        size_t lhash = l._jsonValue->cachedHash();
+        size_t rhash = r._jsonValue->cachedHash();
+        if(lhash && rhash && lhash != rhash)
+            return false;
+        switch(l.getType())
+        {
+            case JsonType::kNull: break;
+            case JsonType::kBool: if(l.toBool() != r.toBool()) return false; break;
+            case JsonType::kNumber: if(l.toNumber() != r.toNumber()) return false; break;
+            case JsonType::kString: if(l.toString() != r.toString()) return false; break;
+            case JsonType::kArray:
+            {
+                if(l.size() != r.size())
+                    return false;
+                for(size_t i = 0; i < l.size(); i++)
+                    stack.push_back({&l[i], &r[i]});
+                break;
+            }
+            default:
+            {
+                if(l.size() != r.size())
+                    return false;
+                const Json::_object& robj = r.toObject();
+                for(auto& it : l.toObject())
+                {
+                    auto found = robj.find(it.first);
+                    if(found == robj.end())
+                        return false;
+                    stack.push_back({&it.second, &found->second});
+                }
+                break;
+            }
+        }
     }
+    return true;
 }
 }//namespace LeptJson
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include<algorithm>
+#include<cmath>
+#include"jsonColumns.h"
+#include"parse.h"
+
+namespace LeptJson
+{
+namespace
+{
+bool isInt(double n)
+{
+    return n == std::floor(n) && std::fabs(n) < 9.2e18;
+}
+
+//同一列中出现的两种类型合并，整数和小数合并成小数，其他组合不能放进同一列
+bool merge(ColumnType& type, ColumnType other)
+{
+    if(type == other)
+        return true;
+    bool numeric = (type == ColumnType::kInt || type == ColumnType::kDouble)
+                && (other == ColumnType::kInt || other == ColumnType::kDouble);
+    if(!numeric)
+        return false;
+    type = ColumnType::kDouble;
+    return true;
+}
+
+[[noreturn]] void mismatch(const Column& col)
+{
+    throw JsonException("COLUMN TYPE MISMATCH: " + col.name);
+}
+
+//下面几个函数改写第row行，这一行已经由beginRow()填好了默认值
+void setValid(Column& col, size_t row, bool valid)
+{
+    uint64_t bit = 1ull << (row % 64);
+    if(valid)
+        col.validity[row / 64] |= bit;
+    else
+        col.validity[row / 64] &= ~bit;
+}
+
+void setBool(Column& col, size_t row, bool val)
+{
+    if(col.type != ColumnType::kBool)
+        mismatch(col);
+    col.bools[row] = val;
+    setValid(col, row, true);
+}
+
+void setNumber(Column& col, size_t row, double val)
+{
+    if(col.type == ColumnType::kInt && !isInt(val))
+    {
+        //整列转成小数，null行的0也一起转
+        col.doubles.assign(col.ints.begin(), col.ints.end());
+        col.ints.clear();
+        col.ints.shrink_to_fit();
+        col.type = ColumnType::kDouble;
+    }
+    if(col.type == ColumnType::kInt)
+        col.ints[row] = static_cast<int64_t>(val);
+    else if(col.type == ColumnType::kDouble)
+        col.doubles[row] = val;
+    else
+        mismatch(col);
+    setValid(col, row, true);
+}
+
+void setString(Column& col, size_t row, std::string_view val)
+{
+    if(col.type != ColumnType::kString)
+        mismatch(col);
+    //当前行的字符串在bytes的末尾，重复写入同一行时先去掉原来的内容
+    col.bytes.resize(col.offsets[row]);
+    col.bytes.append(val);
+    col.offsets[row + 1] = col.bytes.size();
+    setValid(col, row, true);
+}
+
+void setValue(Column& col, size_t row, const Json& val)
+{
+    switch(val.getType())
+    {
+        case JsonType::kNull: setValid(col, row, false); break;
+        case JsonType::kBool: setBool(col, row, val.toBool()); break;
+        case JsonType::kNumber: setNumber(col, row, val.toNumber()); break;
+        case JsonType::kString: setString(col, row, val.toString()); break;
+        default: mismatch(col);
+    }
+}
+}//namespace
+
+const Column* ColumnTable::column(std::string_view name) const noexcept
+{
+    auto it = _index.find(std::string(name));
+    return it == _index.end() ? nullptr : &_columns[it->second];
+}
+
+//按字段第一次出现的顺序建列
+void ColumnTable::infer(const Json* records, size_t count)
+{
+    struct Candidate
+    {
+        std::string name;
+        ColumnType type;
+        bool typed;     //出现过非null的值
+        bool usable;    //没有出现过容器或者不能合并的类型
+    };
+    std::vector<Candidate> candidates;
+    std::unordered_map<std::string, size_t> seen;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!records[i].isObject())
+            throw JsonException("EXPECT OBJECT");
+        for(auto& it : records[i].toObject())
+        {
+            auto inserted = seen.emplace(it.first, candidates.size());
+            if(inserted.second)
+                candidates.push_back({it.first, ColumnType::kBool, false, true});
+            Candidate& candidate = candidates[inserted.first->second];
+            ColumnType type;
+            switch(it.second.getType())
+            {
+                case JsonType::kNull: continue;
+                case JsonType::kBool: type = ColumnType::kBool; break;
+                case JsonType::kNumber: type = isInt(it.second.toNumber()) ? ColumnType::kInt : ColumnType::kDouble; break;
+                case JsonType::kString: type = ColumnType::kString; break;
+                default: candidate.usable = false; continue;
+            }
+            if(!candidate.typed)
+            {
+                candidate.type = type;
+                candidate.typed = true;
+            }
+            else if(!merge(candidate.type, type))
+            {
+                candidate.usable = false;
+            }
+        }
+    }
+    for(auto& candidate : candidates)
+    {
+        if(candidate.typed && candidate.usable)
+        {
+            _columns.emplace_back();
+            _columns.back().name = std::move(candidate.name);
+            _columns.back().type = candidate.type;
+        }
+    }
+    for(size_t i = 0; i < _columns.size(); i++)
+        _index.emplace(_columns[i].name, i);
+}
+
+//每一列追加一个默认值
+void ColumnTable::beginRow()
+{
+    size_t row = _rows++;
+    for(auto& col : _columns)
+    {
+        if(row % 64 == 0)
+            col.validity.push_back(0);
+        switch(col.type)
+        {
+            case ColumnType::kBool: col.bools.push_back(0); break;
+            case ColumnType::kInt: col.ints.push_back(0); break;
+            case ColumnType::kDouble: col.doubles.push_back(0); break;
+            default: col.offsets.push_back(col.offsets.back()); break;
+        }
+    }
+}
+
+//记录的key顺序通常相同，先试上一列的下一列，不命中再查哈希表
+Column* ColumnTable::find(const std::string& key, size_t& hint)
+{
+    if(hint < _columns.size() && _columns[hint].name == key)
+        return &_columns[hint++];
+    auto it = _index.find(key);
+    if(it == _index.end())
+        return nullptr;
+    hint = it->second + 1;
+    return &_columns[it->second];
+}
+
+void ColumnTable::append(const Json& record)
+{
+    if(!record.isObject())
+        throw JsonException("EXPECT OBJECT");
+    beginRow();
+    size_t hint = 0;
+    for(auto& it : record.toObject())
+    {
+        if(Column* col = find(it.first, hint))
+            setValue(*col, _rows - 1, it.second);
+    }
+}
+
+//从解析器直接读一条记录，不需要的值跳过
+void ColumnTable::read(Parser& p)
+{
+    p.expect('{', "EXPECT OBJECT");
+    beginRow();
+    size_t row = _rows - 1;
+    if(p.consume('}'))
+        return;
+    size_t hint = 0;
+    do
+    {
+        std::string key = p.readString();
+        p.expect(':', "MISS COLON");
+        Column* col = find(key, hint);
+        if(!col)
+        {
+            p.skipValue();
+            continue;
+        }
+        switch(p.peek())
+        {
+            case 'n':
+                p.readNull();
+                setValid(*col, row, false);
+                break;
+            case 't':
+            case 'f':
+                setBool(*col, row, p.readBool());
+                break;
+            case '\"':
+                setString(*col, row, p.readString());
+                break;
+            case '[':
+            case '{':
+                mismatch(*col);
+            default:
+                setNumber(*col, row, p.readNumber());
+                break;
+        }
+    } while(p.consume(','));
+    p.expect('}', "MISS COMMA OR CURLY BRACKET");
+}
+
+//load()和parse()用同样的规则，inferRows为0时也至少用一条记录推断
+static size_t inferLimit(const ColumnOptions& options) noexcept
+{
+    return std::max<size_t>(options.inferRows, 1);
+}
+
+bool ColumnTable::load(const Json& records, std::string& errMsg, const ColumnOptions& options) noexcept
+{
+    *this = ColumnTable();
+    try
+    {
+        if(!records.isArray())
+            throw JsonException("EXPECT ARRAY");
+        const Json::_array& arr = records.toArray();
+        infer(arr.data(), std::min(arr.size(), inferLimit(options)));
+        for(auto& record : arr)
+            append(record);
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        *this = ColumnTable();
+        return false;
+    }
+}
+
+//前inferRows条记录先解析成Json用来推断列，之后的记录直接写进列
+bool ColumnTable::parse(const std::string& content, std::string& errMsg, const ColumnOptions& options) noexcept
+{
+    *this = ColumnTable();
+    try
+    {
+        Parser p(content);
+        std::vector<Json> head;
+        bool inferred = false;
+        auto flush = [&] {
+            infer(head.data(), head.size());
+            for(auto& record : head)
+                append(record);
+            head.clear();
+            inferred = true;
+        };
+        p.expect('[', "EXPECT ARRAY");
+        if(!p.consume(']'))
+        {
+            do
+            {
+                if(!inferred && head.size() < inferLimit(options))
+                {
+                    head.push_back(p.readValue());
+                    continue;
+                }
+                if(!inferred)
+                    flush();
+                read(p);
+            } while(p.consume(','));
+            p.expect(']', "MISS COMMA OR SQUARE BRACKET");
+        }
+        p.finish();
+        if(!inferred)
+            flush();
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        *this = ColumnTable();
+        return false;
+    }
+}
+}//namespace LeptJson
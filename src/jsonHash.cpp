@@ -0,0 +1,365 @@
+#include<algorithm>
+#include<charconv>
+#include<cmath>
+#include<cstdlib>
+#include<cstring>
+#include<string_view>
+#include<vector>
+#include"json.h"
+#include"jsonException.h"
+#include"jsonValue.h"
+#include"scan.h"
+
+namespace LeptJson
+{
+//splitmix64的终结函数，把组合后的值重新打散
+static size_t mix(size_t h)
+{
+    uint64_t x = h;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return static_cast<size_t>(x);
+}
+
+//每种类型一个种子，避免[]、{}、""、null互相碰撞
+enum : size_t
+{
+    kNullSeed = 0x6E756C6Cull,
+    kFalseSeed = 0x66616C73ull,
+    kTrueSeed = 0x74727565ull,
+    kNumberSeed = 0x6E756D62ull,
+    kStringSeed = 0x73747269ull,
+    kArraySeed = 0x61727261ull,
+    kObjectSeed = 0x6F626A65ull,
+};
+
+//0留给"没有缓存"
+static size_t nonZero(size_t h)
+{
+    return h ? h : 1;
+}
+
+//-0和0相等，哈希也要相同
+static size_t hashNumber(double val)
+{
+    if(val == 0)
+        val = 0;
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    return mix(bits ^ kNumberSeed);
+}
+
+static size_t hashString(const std::string& str)
+{
+    return mix(std::hash<std::string_view>()(str) ^ kStringSeed);
+}
+
+//显式栈后序遍历，容器的哈希由子节点组合而来
+//数组按顺序组合，对象把每个成员的哈希相加，与遍历顺序无关
+size_t Json::hash() const noexcept
+{
+    struct Frame
+    {
+        const Json* json;
+        size_t index;
+        _object::const_iterator it;
+        size_t acc;
+    };
+    std::vector<Frame> stack;
+    const Json* next = this;
+    size_t h = 0;
+    while(1)
+    {
+        //计算一个值，没有缓存的容器入栈
+        bool pushed = false;
+        const JsonValue& node = *next->_jsonValue;
+        h = node.cachedHash();
+        if(h)
+        {
+            //共享的子树或者之前算过的节点直接用缓存
+        }
+        else if(auto packed = node.getPacked())
+        {
+            //和同样内容的普通数组得到相同的哈希
+            size_t acc = kArraySeed;
+            for(size_t i = 0; i < packed->size(); i++)
+                acc = mix(acc * 31 + hashNumber(packed->at(i)));
+            h = nonZero(mix(acc ^ packed->size()));
+            node.cacheHash(h);
+        }
+        else if(node.getArray())
+        {
+            stack.push_back({next, 0, {}, kArraySeed});
+            pushed = true;
+        }
+        else if(auto obj = node.getObject())
+        {
+            stack.push_back({next, 0, obj->begin(), kObjectSeed});
+            pushed = true;
+        }
+        else
+        {
+            switch(node.getType())
+            {
+                case JsonType::kNull: h = mix(kNullSeed); break;
+                case JsonType::kBool: h = mix(node.toBool() ? kTrueSeed : kFalseSeed); break;
+                case JsonType::kNumber: h = hashNumber(node.toNumber()); break;
+                default:
+                    h = nonZero(hashString(node.toString()));
+                    node.cacheHash(h);
+                    break;
+            }
+        }
+        //把结果合并到父节点，找到下一个子节点，算完的容器出栈
+        next = nullptr;
+        while(!next)
+        {
+            if(!pushed)
+            {
+                if(stack.empty())
+                    return h;
+                Frame& parent = stack.back();
+                if(parent.json->isArray())
+                {
+                    parent.acc = mix(parent.acc * 31 + h);
+                }
+                else
+                {
+                    parent.acc += mix(hashString(parent.it->first) * 31 + h);
+                    ++parent.it;
+                }
+            }
+            pushed = false;
+            Frame& top = stack.back();
+            const JsonValue& node = *top.json->_jsonValue;
+            if(auto arr = node.getArray())
+            {
+                if(top.index < arr->size())
+                {
+                    next = &(*arr)[top.index++];
+                    continue;
+                }
+            }
+            else if(top.it != node.getObject()->end())
+            {
+                next = &top.it->second;
+                continue;
+            }
+            h = nonZero(mix(top.acc ^ top.json->size()));
+            node.cacheHash(h);
+            stack.pop_back();
+        }
+    }
+}
+
+//RFC 8785要求的数字格式，和ECMAScript的Number.prototype.toString一致
+//先用to_chars得到最短的科学计数法，再按指数决定写成整数、小数还是指数形式
+static void formatCanonicalNumber(double val, std::string& res)
+{
+    //RFC 8785不允许NaN和无穷
+    if(!std::isfinite(val))
+        throw JsonException("NUMBER NOT FINITE");
+    if(val == 0)
+    {
+        res += '0';
+        return;
+    }
+    char buffer[32];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer) - 1, val, std::chars_format::scientific).ptr;
+    *end = '\0';
+    const char* p = buffer;
+    if(*p == '-')
+    {
+        res += '-';
+        p++;
+    }
+    //d.ddde+XX拆成数字串和指数
+    std::string digits;
+    for(; p != end && *p != 'e'; p++)
+        if(*p != '.')
+            digits += *p;
+    int exp = p == end ? 0 : atoi(p + 1);
+    int k = static_cast<int>(digits.size());
+    int n = exp + 1;
+    if(k <= n && n <= 21)
+    {
+        res += digits;
+        res.append(n - k, '0');
+    }
+    else if(0 < n && n <= 21)
+    {
+        res.append(digits, 0, n);
+        res += '.';
+        res.append(digits, n, std::string::npos);
+    }
+    else if(-6 < n && n <= 0)
+    {
+        res += "0.";
+        res.append(-n, '0');
+        res += digits;
+    }
+    else
+    {
+        res += digits[0];
+        if(k > 1)
+        {
+            res += '.';
+            res.append(digits, 1, std::string::npos);
+        }
+        res += 'e';
+        res += n - 1 > 0 ? '+' : '-';
+        res += std::to_string(std::abs(n - 1));
+    }
+}
+
+//只转义引号、反斜杠和控制字符，控制字符用小写十六进制
+static void escapeCanonical(const std::string& str, std::string& res)
+{
+    static const char kHex[] = "0123456789abcdef";
+    res += '"';
+    const char* p = str.data();
+    const char* end = p + str.size();
+    while(1)
+    {
+        const char* run = p;
+        p = scanStringRun(p, end);
+        res.append(run, p);
+        if(p == end)
+            break;
+        char ch = *p++;
+        switch(ch)
+        {
+            case '"': res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\b': res += "\\b"; break;
+            case '\f': res += "\\f"; break;
+            case '\n': res += "\\n"; break;
+            case '\r': res += "\\r"; break;
+            case '\t': res += "\\t"; break;
+            default:
+                res += "\\u00";
+                res += kHex[(ch >> 4) & 0xF];
+                res += kHex[ch & 0xF];
+                break;
+        }
+    }
+    res += '"';
+}
+
+//把UTF-8的key转成UTF-16码元序列，用来排序
+static std::u16string toUtf16(const std::string& str)
+{
+    std::u16string res;
+    res.reserve(str.size());
+    for(size_t i = 0; i < str.size(); )
+    {
+        auto ch = static_cast<unsigned char>(str[i]);
+        size_t len = ch < 0x80 ? 1 : ch >= 0xF0 ? 4 : ch >= 0xE0 ? 3 : 2;
+        unsigned u = len == 1 ? ch : ch & (0x7F >> len);
+        for(size_t j = 1; j < len && i + j < str.size(); j++)
+            u = (u << 6) | (static_cast<unsigned char>(str[i + j]) & 0x3F);
+        i += len;
+        if(u >= 0x10000)
+        {
+            u -= 0x10000;
+            res += static_cast<char16_t>(0xD800 | (u >> 10));
+            res += static_cast<char16_t>(0xDC00 | (u & 0x3FF));
+        }
+        else
+        {
+            res += static_cast<char16_t>(u);
+        }
+    }
+    return res;
+}
+
+std::string Json::canonicalize() const
+{
+    struct Member
+    {
+        std::u16string order;
+        const std::string* key;
+        const Json* val;
+    };
+    struct Frame
+    {
+        const Json* json;
+        size_t index;
+        std::vector<Member> members;
+    };
+    std::string res;
+    std::vector<Frame> stack;
+    const Json* next = this;
+    while(1)
+    {
+        if(auto packed = next->_jsonValue->getPacked())
+        {
+            res += '[';
+            for(size_t i = 0; i < packed->size(); i++)
+            {
+                if(i > 0)
+                    res += ',';
+                formatCanonicalNumber(packed->at(i), res);
+            }
+            res += ']';
+        }
+        else if(next->isArray())
+        {
+            res += '[';
+            stack.push_back({next, 0, {}});
+        }
+        else if(next->isObject())
+        {
+            res += '{';
+            std::vector<Member> members;
+            members.reserve(next->size());
+            for(auto& it : next->toObject())
+                members.push_back({toUtf16(it.first), &it.first, &it.second});
+            std::sort(members.begin(), members.end(),
+                      [](const Member& a, const Member& b) {return a.order < b.order;});
+            stack.push_back({next, 0, std::move(members)});
+        }
+        else
+        {
+            switch(next->getType())
+            {
+                case JsonType::kNull: res += "null"; break;
+                case JsonType::kBool: res += next->toBool() ? "true" : "false"; break;
+                case JsonType::kNumber: formatCanonicalNumber(next->toNumber(), res); break;
+                default: escapeCanonical(next->toString(), res); break;
+            }
+        }
+        next = nullptr;
+        while(!next && !stack.empty())
+        {
+            Frame& top = stack.back();
+            size_t size = top.json->size();
+            if(top.index == size)
+            {
+                res += top.json->isArray() ? ']' : '}';
+                stack.pop_back();
+                continue;
+            }
+            if(top.index > 0)
+                res += ',';
+            if(top.json->isArray())
+            {
+                next = &(*top.json)[top.index];
+            }
+            else
+            {
+                const Member& member = top.members[top.index];
+                escapeCanonical(*member.key, res);
+                res += ':';
+                next = member.val;
+            }
+            top.index++;
+        }
+        if(!next)
+            return res;
+    }
+}
+}//namespace LeptJson
@@ -0,0 +1,422 @@
+#include<algorithm>
+#include<utility>
+#include<vector>
+#include"jsonPatch.h"
+#include"jsonException.h"
+#include"jsonValue.h"
+
+namespace LeptJson
+{
+//沿路径修改用的子节点引用，只在一个操作内部使用，不会交给调用方
+//所以不像非const的[]那样把节点标记为不能共享
+struct PatchAccess
+{
+    static Json& child(Json& parent, size_t index)
+    {
+        parent.detach();
+        return (*parent._jsonValue)[index];
+    }
+    //key不存在时插入null
+    static Json& member(Json& parent, const std::string& key)
+    {
+        return parent.mutableObject()[key];
+    }
+};
+
+namespace
+{
+//把JSON Pointer拆成token，~1还原为/，~0还原为~
+std::vector<std::string> splitPointer(const std::string& pointer)
+{
+    std::vector<std::string> tokens;
+    if(pointer.empty())
+        return tokens;
+    if(pointer[0] != '/')
+        throw JsonException("INVALID POINTER: " + pointer);
+    for(size_t i = 1; ; i++)
+    {
+        std::string token;
+        for(; i < pointer.size() && pointer[i] != '/'; i++)
+        {
+            if(pointer[i] != '~')
+                token += pointer[i];
+            else if(i + 1 < pointer.size() && (pointer[i + 1] == '0' || pointer[i + 1] == '1'))
+                token += pointer[++i] == '0' ? '~' : '/';
+            else
+                throw JsonException("INVALID POINTER: " + pointer);
+        }
+        tokens.push_back(std::move(token));
+        if(i >= pointer.size())
+            return tokens;
+    }
+}
+
+std::string escapeToken(const std::string& token)
+{
+    std::string res;
+    for(char ch : token)
+    {
+        if(ch == '~')
+            res += "~0";
+        else if(ch == '/')
+            res += "~1";
+        else
+            res += ch;
+    }
+    return res;
+}
+
+//数组下标，不允许前导0，allowEnd时"-"表示末尾
+size_t toIndex(const std::string& token, size_t size, bool allowEnd, const std::string& path)
+{
+    if(allowEnd && token == "-")
+        return size;
+    if(token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1))
+        throw JsonException("INVALID INDEX: " + path);
+    size_t index = 0;
+    for(char ch : token)
+    {
+        if(ch < '0' || ch > '9')
+            throw JsonException("INVALID INDEX: " + path);
+        index = index * 10 + (ch - '0');
+    }
+    if(index > size || (!allowEnd && index == size))
+        throw JsonException("PATH NOT FOUND: " + path);
+    return index;
+}
+
+const Json* find(const Json& root, const std::vector<std::string>& tokens, size_t count, const std::string& path)
+{
+    const Json* curr = &root;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(curr->isObject())
+        {
+            auto it = curr->toObject().find(tokens[i]);
+            if(it == curr->toObject().end())
+                throw JsonException("PATH NOT FOUND: " + path);
+            curr = &it->second;
+        }
+        else if(curr->isArray())
+        {
+            curr = &(*curr)[toIndex(tokens[i], curr->size(), false, path)];
+        }
+        else
+        {
+            throw JsonException("PATH NOT FOUND: " + path);
+        }
+    }
+    return curr;
+}
+
+//沿路径走到第count层，经过的节点都通过非const的[]独占
+Json& locate(Json& root, const std::vector<std::string>& tokens, size_t count, const std::string& path)
+{
+    //先用只读查找确认路径存在，避免[]插入新的key
+    find(root, tokens, count, path);
+    Json* curr = &root;
+    for(size_t i = 0; i < count; i++)
+    {
+        if(curr->isObject())
+            curr = &PatchAccess::member(*curr, tokens[i]);
+        else
+            curr = &PatchAccess::child(*curr, toIndex(tokens[i], curr->size(), false, path));
+    }
+    return *curr;
+}
+
+//撤销一步修改要做的操作，失败时按相反的顺序执行，把target恢复原样
+struct Undo
+{
+    enum Kind {kAdd, kRemove, kReplace} kind;
+    std::vector<std::string> tokens;    //数组下标已经换成具体的数字
+    Json val;                           //kAdd和kReplace写回的值
+};
+using UndoLog = std::vector<Undo>;
+
+//被替换的旧值换进撤销记录，不复制
+void replaceAt(Json& slot, Json val, const std::vector<std::string>& tokens, UndoLog* log)
+{
+    if(log)
+    {
+        log->push_back({Undo::kReplace, tokens, Json()});
+        std::swap(slot, log->back().val);
+    }
+    slot = std::move(val);
+}
+
+void add(Json& root, const std::vector<std::string>& tokens, Json val, const std::string& path, UndoLog* log)
+{
+    if(tokens.empty())
+    {
+        replaceAt(root, std::move(val), tokens, log);
+        return;
+    }
+    Json& parent = locate(root, tokens, tokens.size() - 1, path);
+    const std::string& last = tokens.back();
+    if(parent.isObject())
+    {
+        if(parent.toObject().count(last))
+        {
+            replaceAt(PatchAccess::member(parent, last), std::move(val), tokens, log);
+            return;
+        }
+        PatchAccess::member(parent, last) = std::move(val);
+        if(log)
+            log->push_back({Undo::kRemove, tokens, Json()});
+    }
+    else if(parent.isArray())
+    {
+        size_t index = toIndex(last, parent.size(), true, path);
+        parent.insert(index, std::move(val));
+        if(log)
+        {
+            log->push_back({Undo::kRemove, tokens, Json()});
+            log->back().tokens.back() = std::to_string(index);
+        }
+    }
+    else
+    {
+        throw JsonException("PATH NOT FOUND: " + path);
+    }
+}
+
+//删除并返回原来的值，撤销记录里保存同一个值
+Json remove(Json& root, const std::vector<std::string>& tokens, const std::string& path, UndoLog* log)
+{
+    if(tokens.empty())
+        throw JsonException("CANNOT REMOVE ROOT: " + path);
+    find(root, tokens, tokens.size(), path);
+    Json& parent = locate(root, tokens, tokens.size() - 1, path);
+    const std::string& last = tokens.back();
+    Json val;
+    if(parent.isObject())
+    {
+        val = std::move(PatchAccess::member(parent, last));
+        parent.erase(last);
+    }
+    else
+    {
+        size_t index = toIndex(last, parent.size(), false, path);
+        val = std::move(PatchAccess::child(parent, index));
+        parent.erase(index);
+    }
+    if(log)
+        log->push_back({Undo::kAdd, tokens, val});
+    return val;
+}
+
+//撤销记录中的路径都是执行时确认过的，按相反顺序执行时一定存在
+void rollback(Json& root, UndoLog& log)
+{
+    const std::string path;
+    for(auto it = log.rbegin(); it != log.rend(); ++it)
+    {
+        switch(it->kind)
+        {
+            case Undo::kAdd: add(root, it->tokens, std::move(it->val), path, nullptr); break;
+            case Undo::kRemove: remove(root, it->tokens, path, nullptr); break;
+            default: locate(root, it->tokens, it->tokens.size(), path) = std::move(it->val); break;
+        }
+    }
+    log.clear();
+}
+
+const std::string& member(const Json& op, const char* name)
+{
+    if(!op.isObject() || !op.toObject().count(name) || !op[name].isString())
+        throw JsonException(std::string("INVALID PATCH: MISS ") + name);
+    return op[name].toString();
+}
+
+const Json& valueOf(const Json& op)
+{
+    auto it = op.toObject().find("value");
+    if(it == op.toObject().end())
+        throw JsonException("INVALID PATCH: MISS value");
+    return it->second;
+}
+
+void applyOperation(Json& root, const Json& op, UndoLog& log)
+{
+    const std::string& name = member(op, "op");
+    const std::string& path = member(op, "path");
+    std::vector<std::string> tokens = splitPointer(path);
+    if(name == "add")
+    {
+        add(root, tokens, valueOf(op), path, &log);
+    }
+    else if(name == "remove")
+    {
+        remove(root, tokens, path, &log);
+    }
+    else if(name == "replace")
+    {
+        replaceAt(locate(root, tokens, tokens.size(), path), valueOf(op), tokens, &log);
+    }
+    else if(name == "move" || name == "copy")
+    {
+        const std::string& from = member(op, "from");
+        std::vector<std::string> fromTokens = splitPointer(from);
+        if(name == "copy")
+        {
+            //拷贝只增加引用计数
+            add(root, tokens, *find(root, fromTokens, fromTokens.size(), from), path, &log);
+            return;
+        }
+        if(from == path)
+        {
+            find(root, fromTokens, fromTokens.size(), from);
+            return;
+        }
+        //不能移动到自己的子节点下
+        if(path.compare(0, from.size(), from) == 0 && path.size() > from.size() && path[from.size()] == '/')
+            throw JsonException("CANNOT MOVE INTO CHILD: " + path);
+        add(root, tokens, remove(root, fromTokens, from, &log), path, &log);
+    }
+    else if(name == "test")
+    {
+        if(*find(root, tokens, tokens.size(), path) != valueOf(op))
+            throw JsonException("TEST FAILED: " + path);
+    }
+    else
+    {
+        throw JsonException("INVALID PATCH: UNKNOWN OP " + name);
+    }
+}
+
+void addOperation(Json& patch, const char* op, const std::string& path, const Json* val)
+{
+    Json::_object obj;
+    obj["op"] = Json(op);
+    obj["path"] = Json(path);
+    if(val)
+        obj["value"] = *val;
+    patch.push_back(Json(std::move(obj)));
+}
+
+void diffValue(const Json& from, const Json& to, std::string& path, Json& patch)
+{
+    if(from.shares(to))
+        return;
+    if(from.isObject() && to.isObject())
+    {
+        size_t len = path.size();
+        auto& lhs = from.toObject();
+        auto& rhs = to.toObject();
+        for(auto& it : lhs)
+        {
+            path += '/' + escapeToken(it.first);
+            auto match = rhs.find(it.first);
+            if(match == rhs.end())
+                addOperation(patch, "remove", path, nullptr);
+            else
+                diffValue(it.second, match->second, path, patch);
+            path.resize(len);
+        }
+        for(auto& it : rhs)
+        {
+            if(lhs.count(it.first))
+                continue;
+            addOperation(patch, "add", path + '/' + escapeToken(it.first), &it.second);
+        }
+        return;
+    }
+    if(from.isArray() && to.isArray())
+    {
+        size_t len = path.size();
+        size_t fromEnd = from.size();
+        size_t toEnd = to.size();
+        size_t begin = 0;
+        //去掉公共前缀和后缀
+        while(begin < fromEnd && begin < toEnd && from[begin] == to[begin])
+            begin++;
+        while(fromEnd > begin && toEnd > begin && from[fromEnd - 1] == to[toEnd - 1])
+        {
+            fromEnd--;
+            toEnd--;
+        }
+        size_t common = std::min(fromEnd, toEnd);
+        for(size_t i = begin; i < common; i++)
+        {
+            path += '/' + std::to_string(i);
+            diffValue(from[i], to[i], path, patch);
+            path.resize(len);
+        }
+        //从后往前删除，前面的下标不受影响
+        for(size_t i = fromEnd; i > common; i--)
+            addOperation(patch, "remove", path + '/' + std::to_string(i - 1), nullptr);
+        for(size_t i = common; i < toEnd; i++)
+            addOperation(patch, "add", path + '/' + std::to_string(i), &to[i]);
+        return;
+    }
+    if(from != to)
+        addOperation(patch, "replace", path, &to);
+}
+}//namespace
+
+const Json* resolvePointer(const Json& root, const std::string& pointer) noexcept
+{
+    try
+    {
+        std::vector<std::string> tokens = splitPointer(pointer);
+        return find(root, tokens, tokens.size(), pointer);
+    }
+    catch(JsonException&)
+    {
+        return nullptr;
+    }
+}
+
+void mergePatch(Json& target, const Json& patch)
+{
+    if(!patch.isObject())
+    {
+        target = patch;
+        return;
+    }
+    if(!target.isObject())
+        target = Json(Json::_object());
+    for(auto& it : patch.toObject())
+    {
+        if(it.second.isNull())
+            target.erase(it.first);
+        else
+            mergePatch(PatchAccess::member(target, it.first), it.second);
+    }
+}
+
+//直接在target上修改，每一步记下撤销操作，失败时倒序撤销
+bool applyPatch(Json& target, const Json& patch, std::string& errMsg) noexcept
+{
+    UndoLog log;
+    try
+    {
+        if(!patch.isArray())
+            throw JsonException("INVALID PATCH: EXPECT ARRAY");
+        for(auto& op : patch.toArray())
+            applyOperation(target, op, log);
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        rollback(target, log);
+        errMsg = e.what();
+        return false;
+    }
+    catch(std::exception& e)
+    {
+        rollback(target, log);
+        errMsg = e.what();
+        return false;
+    }
+}
+
+Json diff(const Json& from, const Json& to)
+{
+    Json patch{Json::_array()};
+    std::string path;
+    diffValue(from, to, path, patch);
+    return patch;
+}
+}//namespace LeptJson
@@ -0,0 +1,678 @@
+#include<algorithm>
+#include<cctype>
+#include<cstdlib>
+#include<cstring>
+#include<exception>
+#include<thread>
+#include"jsonException.h"
+#include"jsonPath.h"
+
+namespace LeptJson
+{
+namespace
+{
+struct Expr;
+
+//一个选择器，[a,b]里的每一项各是一个
+struct Selector
+{
+    enum Kind {kName, kIndex, kSlice, kWildcard, kFilter};
+    Kind kind = kName;
+    std::string name;
+    long long index = 0;
+    long long start = 0;
+    long long end = 0;
+    long long step = 1;
+    bool hasStart = false;
+    bool hasEnd = false;
+    std::shared_ptr<const Expr> filter;
+};
+
+//过滤表达式的语法树，其中的路径只含名字和下标
+struct Expr
+{
+    enum Op {kOr, kAnd, kNot, kEq, kNe, kLt, kLe, kGt, kGe, kPath, kLiteral};
+    Op op = kLiteral;
+    std::vector<Expr> operands;
+    bool absolute = false;      //$开头的路径
+    std::vector<Selector> path;
+    Json literal;
+};
+
+struct Segment
+{
+    bool recursive = false;
+    std::vector<Selector> selectors;
+};
+
+//递归下降的编译器，出错时报告剩下的部分
+class Compiler
+{
+public:
+    explicit Compiler(const std::string& expression) : _text(expression){}
+
+    std::vector<Segment> compile()
+    {
+        skipSpace();
+        if(!consume('$'))
+            fail();
+        std::vector<Segment> segments;
+        while(1)
+        {
+            skipSpace();
+            if(_pos == _text.size())
+                return segments;
+            segments.push_back(segment());
+        }
+    }
+
+private:
+    [[noreturn]] void fail() const
+    {
+        throw JsonException("INVALID JSONPATH: " + _text.substr(std::min(_pos, _text.size())));
+    }
+
+    char peek(size_t offset = 0) const noexcept
+    {
+        return _pos + offset < _text.size() ? _text[_pos + offset] : '\0';
+    }
+
+    bool consume(char ch) noexcept
+    {
+        if(peek() != ch)
+            return false;
+        _pos++;
+        return true;
+    }
+
+    bool consume(const char* token) noexcept
+    {
+        size_t len = strlen(token);
+        if(_text.compare(_pos, len, token) != 0)
+            return false;
+        _pos += len;
+        return true;
+    }
+
+    void skipSpace() noexcept
+    {
+        while(peek() == ' ' || peek() == '\t' || peek() == '\r' || peek() == '\n')
+            _pos++;
+    }
+
+    Segment segment()
+    {
+        Segment seg;
+        if(consume('['))
+        {
+            seg.selectors = bracket();
+            return seg;
+        }
+        if(!consume('.'))
+            fail();
+        if(consume('.'))
+        {
+            seg.recursive = true;
+            if(consume('['))
+            {
+                seg.selectors = bracket();
+                return seg;
+            }
+        }
+        Selector sel;
+        if(consume('*'))
+        {
+            sel.kind = Selector::kWildcard;
+        }
+        else
+        {
+            sel.kind = Selector::kName;
+            sel.name = name();
+        }
+        seg.selectors.push_back(std::move(sel));
+        return seg;
+    }
+
+    //.后面不带引号的名字，非ASCII字节都算作名字的一部分
+    std::string name()
+    {
+        size_t begin = _pos;
+        while(1)
+        {
+            auto ch = static_cast<unsigned char>(peek());
+            if(!isalnum(ch) && ch != '_' && ch != '-' && ch < 0x80)
+                break;
+            _pos++;
+        }
+        if(_pos == begin)
+            fail();
+        return _text.substr(begin, _pos - begin);
+    }
+
+    //[之后逗号分隔的选择器，直到]
+    std::vector<Selector> bracket()
+    {
+        std::vector<Selector> selectors;
+        do
+        {
+            skipSpace();
+            selectors.push_back(selector());
+            skipSpace();
+        } while(consume(','));
+        if(!consume(']'))
+            fail();
+        return selectors;
+    }
+
+    Selector selector()
+    {
+        Selector sel;
+        if(consume('*'))
+        {
+            sel.kind = Selector::kWildcard;
+        }
+        else if(peek() == '\'' || peek() == '\"')
+        {
+            sel.kind = Selector::kName;
+            sel.name = quoted();
+        }
+        else if(consume('?'))
+        {
+            //?(...)的括号按普通的括号表达式处理
+            sel.kind = Selector::kFilter;
+            sel.filter = std::make_shared<const Expr>(orExpr());
+        }
+        else
+        {
+            //下标或者切片
+            bool hasFirst = integer(sel.start);
+            skipSpace();
+            if(!consume(':'))
+            {
+                if(!hasFirst)
+                    fail();
+                sel.kind = Selector::kIndex;
+                sel.index = sel.start;
+                return sel;
+            }
+            sel.kind = Selector::kSlice;
+            sel.hasStart = hasFirst;
+            skipSpace();
+            sel.hasEnd = integer(sel.end);
+            skipSpace();
+            if(consume(':'))
+            {
+                skipSpace();
+                integer(sel.step);
+            }
+        }
+        return sel;
+    }
+
+    bool integer(long long& val)
+    {
+        size_t begin = _pos;
+        consume('-');
+        while(isdigit(static_cast<unsigned char>(peek())))
+            _pos++;
+        if(_pos == begin || (_pos == begin + 1 && _text[begin] == '-'))
+        {
+            _pos = begin;
+            return false;
+        }
+        val = strtoll(_text.c_str() + begin, nullptr, 10);
+        return true;
+    }
+
+    //单引号或双引号的字符串，支持常见的反斜杠转义
+    std::string quoted()
+    {
+        char quote = _text[_pos++];
+        std::string str;
+        while(1)
+        {
+            if(_pos >= _text.size())
+                fail();
+            char ch = _text[_pos++];
+            if(ch == quote)
+                return str;
+            if(ch == '\\')
+            {
+                if(_pos >= _text.size())
+                    fail();
+                ch = _text[_pos++];
+                switch(ch)
+                {
+                    case 'b': ch = '\b'; break;
+                    case 'f': ch = '\f'; break;
+                    case 'n': ch = '\n'; break;
+                    case 'r': ch = '\r'; break;
+                    case 't': ch = '\t'; break;
+                    default: break;
+                }
+            }
+            str += ch;
+        }
+    }
+
+    Expr binary(Expr::Op op, Expr lhs, Expr rhs)
+    {
+        Expr expr;
+        expr.op = op;
+        expr.operands.push_back(std::move(lhs));
+        expr.operands.push_back(std::move(rhs));
+        return expr;
+    }
+
+    Expr orExpr()
+    {
+        Expr lhs = andExpr();
+        while(skipSpace(), consume("||"))
+            lhs = binary(Expr::kOr, std::move(lhs), andExpr());
+        return lhs;
+    }
+
+    Expr andExpr()
+    {
+        Expr lhs = unary();
+        while(skipSpace(), consume("&&"))
+            lhs = binary(Expr::kAnd, std::move(lhs), unary());
+        return lhs;
+    }
+
+    Expr unary()
+    {
+        skipSpace();
+        if(consume('!'))
+        {
+            Expr expr;
+            expr.op = Expr::kNot;
+            expr.operands.push_back(unary());
+            return expr;
+        }
+        if(consume('('))
+        {
+            Expr expr = orExpr();
+            skipSpace();
+            if(!consume(')'))
+                fail();
+            return expr;
+        }
+        return comparison();
+    }
+
+    Expr comparison()
+    {
+        static const struct
+        {
+            const char* token;
+            Expr::Op op;
+        } kOps[] = {{"==", Expr::kEq}, {"!=", Expr::kNe}, {"<=", Expr::kLe},
+                    {">=", Expr::kGe}, {"<", Expr::kLt}, {">", Expr::kGt}};
+        Expr lhs = operand();
+        skipSpace();
+        for(auto& it : kOps)
+        {
+            if(consume(it.token))
+                return binary(it.op, std::move(lhs), operand());
+        }
+        //单独的字面量不是一个判断
+        if(lhs.op == Expr::kLiteral)
+            fail();
+        return lhs;
+    }
+
+    Expr operand()
+    {
+        skipSpace();
+        Expr expr;
+        if(peek() == '@' || peek() == '$')
+        {
+            expr.op = Expr::kPath;
+            expr.absolute = _text[_pos++] == '$';
+            while(1)
+            {
+                Selector sel;
+                if(peek() == '.' && peek(1) != '.')
+                {
+                    _pos++;
+                    sel.kind = Selector::kName;
+                    sel.name = name();
+                }
+                else if(consume('['))
+                {
+                    skipSpace();
+                    sel = selector();
+                    skipSpace();
+                    if((sel.kind != Selector::kName && sel.kind != Selector::kIndex) || !consume(']'))
+                        fail();
+                }
+                else
+                {
+                    return expr;
+                }
+                expr.path.push_back(std::move(sel));
+            }
+        }
+        expr.op = Expr::kLiteral;
+        if(peek() == '\'' || peek() == '\"')
+        {
+            expr.literal = Json(quoted());
+        }
+        else if(consume("true"))
+        {
+            expr.literal = Json(true);
+        }
+        else if(consume("false"))
+        {
+            expr.literal = Json(false);
+        }
+        else if(consume("null"))
+        {
+            expr.literal = Json(nullptr);
+        }
+        else
+        {
+            const char* begin = _text.c_str() + _pos;
+            char* end;
+            double n = strtod(begin, &end);
+            if(end == begin)
+                fail();
+            _pos += end - begin;
+            expr.literal = Json(n);
+        }
+        return expr;
+    }
+
+private:
+    const std::string& _text;
+    size_t _pos = 0;
+};
+
+//按名字或下标取一个子节点，不存在时返回nullptr
+const Json* child(const Json& node, const Selector& sel)
+{
+    if(sel.kind == Selector::kName)
+    {
+        if(!node.isObject())
+            return nullptr;
+        auto it = node.toObject().find(sel.name);
+        return it == node.toObject().end() ? nullptr : &it->second;
+    }
+    if(!node.isArray())
+        return nullptr;
+    auto& arr = node.toArray();
+    long long size = static_cast<long long>(arr.size());
+    long long i = sel.index < 0 ? sel.index + size : sel.index;
+    return i < 0 || i >= size ? nullptr : &arr[i];
+}
+
+//单值路径，不存在时返回nullptr
+const Json* resolve(const Json* node, const std::vector<Selector>& path)
+{
+    for(auto& sel : path)
+    {
+        node = child(*node, sel);
+        if(!node)
+            return nullptr;
+    }
+    return node;
+}
+
+//不存在的值只和不存在的值相等，大小只在都是数字或者都是字符串时比较
+bool compare(Expr::Op op, const Json* lhs, const Json* rhs)
+{
+    bool equal = lhs && rhs ? *lhs == *rhs : lhs == rhs;
+    if(op == Expr::kEq)
+        return equal;
+    if(op == Expr::kNe)
+        return !equal;
+    if(equal && (op == Expr::kLe || op == Expr::kGe))
+        return true;
+    if(!lhs || !rhs)
+        return false;
+    bool less, greater;
+    if(lhs->isNumber() && rhs->isNumber())
+    {
+        less = lhs->toNumber() < rhs->toNumber();
+        greater = lhs->toNumber() > rhs->toNumber();
+    }
+    else if(lhs->isString() && rhs->isString())
+    {
+        less = lhs->toString() < rhs->toString();
+        greater = rhs->toString() < lhs->toString();
+    }
+    else
+    {
+        return false;
+    }
+    return op == Expr::kLt || op == Expr::kLe ? less : greater;
+}
+
+const Json* valueOf(const Expr& expr, const Json& node, const Json& root)
+{
+    return expr.op == Expr::kLiteral ? &expr.literal : resolve(expr.absolute ? &root : &node, expr.path);
+}
+
+bool test(const Expr& expr, const Json& node, const Json& root)
+{
+    switch(expr.op)
+    {
+        case Expr::kOr: return test(expr.operands[0], node, root) || test(expr.operands[1], node, root);
+        case Expr::kAnd: return test(expr.operands[0], node, root) && test(expr.operands[1], node, root);
+        case Expr::kNot: return !test(expr.operands[0], node, root);
+        case Expr::kPath: return valueOf(expr, node, root) != nullptr;
+        case Expr::kLiteral: return false;
+        default:
+            return compare(expr.op, valueOf(expr.operands[0], node, root), valueOf(expr.operands[1], node, root));
+    }
+}
+
+//先序遍历得到node和它的所有后代，顺序和文档顺序一致
+void descendants(const Json& node, std::vector<const Json*>& out)
+{
+    std::vector<const Json*> stack{&node};
+    while(!stack.empty())
+    {
+        const Json* curr = stack.back();
+        stack.pop_back();
+        out.push_back(curr);
+        size_t mark = stack.size();
+        if(curr->isArray())
+        {
+            for(auto& e : curr->toArray())
+                stack.push_back(&e);
+        }
+        else if(curr->isObject())
+        {
+            for(auto& it : curr->toObject())
+                stack.push_back(&it.second);
+        }
+        std::reverse(stack.begin() + mark, stack.end());
+    }
+}
+
+class Evaluator
+{
+public:
+    Evaluator(const Json& root, const PathOptions& options) noexcept : _root(root), _options(options){}
+
+    void apply(const Selector& sel, const Json& node, std::vector<const Json*>& out) const
+    {
+        switch(sel.kind)
+        {
+            case Selector::kName:
+            case Selector::kIndex:
+                if(const Json* json = child(node, sel))
+                    out.push_back(json);
+                return;
+            case Selector::kSlice:
+                if(node.isArray())
+                    slice(sel, node.toArray(), out);
+                return;
+            case Selector::kWildcard:
+                if(node.isArray())
+                {
+                    for(auto& e : node.toArray())
+                        out.push_back(&e);
+                }
+                else if(node.isObject())
+                {
+                    for(auto& it : node.toObject())
+                        out.push_back(&it.second);
+                }
+                return;
+            default:
+                if(node.isArray())
+                {
+                    filterArray(*sel.filter, node.toArray(), out);
+                }
+                else if(node.isObject())
+                {
+                    for(auto& it : node.toObject())
+                    {
+                        if(test(*sel.filter, it.second, _root))
+                            out.push_back(&it.second);
+                    }
+                }
+                return;
+        }
+    }
+
+private:
+    //负数从末尾数，越界的部分截掉，step为0时没有结果
+    static void slice(const Selector& sel, const Json::_array& arr, std::vector<const Json*>& out)
+    {
+        long long size = static_cast<long long>(arr.size());
+        auto normalize = [size](long long i) {return i < 0 ? i + size : i;};
+        if(sel.step > 0)
+        {
+            long long lower = std::clamp(sel.hasStart ? normalize(sel.start) : 0, 0LL, size);
+            long long upper = std::clamp(sel.hasEnd ? normalize(sel.end) : size, 0LL, size);
+            for(long long i = lower; i < upper; i += sel.step)
+            {
+                out.push_back(&arr[i]);
+                //先比较剩余距离再前进，step很大时i += step会溢出
+                if(sel.step >= upper - i)
+                    break;
+            }
+        }
+        else if(sel.step < 0)
+        {
+            long long upper = std::clamp(sel.hasStart ? normalize(sel.start) : size - 1, -1LL, size - 1);
+            long long lower = std::clamp(sel.hasEnd ? normalize(sel.end) : -1, -1LL, size - 1);
+            for(long long i = upper; i > lower; i += sel.step)
+            {
+                out.push_back(&arr[i]);
+                if(sel.step <= lower - i)
+                    break;
+            }
+        }
+    }
+
+    void filterRange(const Expr& filter, const Json::_array& arr, size_t begin, size_t end,
+                     std::vector<const Json*>& out) const
+    {
+        for(size_t i = begin; i < end; i++)
+        {
+            if(test(filter, arr[i], _root))
+                out.push_back(&arr[i]);
+        }
+    }
+
+    //大数组按下标切成连续的几段，各自过滤后按顺序拼接
+    void filterArray(const Expr& filter, const Json::_array& arr, std::vector<const Json*>& out) const
+    {
+        size_t threads = _options.threads;
+        if(threads <= 1 || arr.size() < std::max<size_t>(_options.parallelThreshold, threads))
+        {
+            filterRange(filter, arr, 0, arr.size(), out);
+            return;
+        }
+        size_t per = (arr.size() + threads - 1) / threads;
+        std::vector<std::vector<const Json*>> parts(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        //离开作用域时等待已经启动的线程，创建线程或者本线程的过滤抛出异常时也不会留下joinable的线程
+        struct Workers
+        {
+            std::vector<std::thread> threads;
+            ~Workers()
+            {
+                for(auto& thread : threads)
+                    if(thread.joinable())
+                        thread.join();
+            }
+        } workers;
+        workers.threads.reserve(threads - 1);
+        for(size_t t = 1; t < threads; t++)
+        {
+            size_t begin = std::min(arr.size(), t * per);
+            size_t end = std::min(arr.size(), begin + per);
+            //线程里的异常先保存下来，全部结束后再抛出
+            workers.threads.emplace_back([this, &filter, &arr, &parts, &errors, t, begin, end] {
+                try
+                {
+                    filterRange(filter, arr, begin, end, parts[t]);
+                }
+                catch(...)
+                {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        filterRange(filter, arr, 0, std::min(arr.size(), per), parts[0]);
+        for(auto& thread : workers.threads)
+            thread.join();
+        for(auto& error : errors)
+            if(error)
+                std::rethrow_exception(error);
+        for(auto& part : parts)
+            out.insert(out.end(), part.begin(), part.end());
+    }
+
+private:
+    const Json& _root;
+    const PathOptions& _options;
+};
+}//namespace
+
+struct JsonPath::Plan
+{
+    std::vector<Segment> segments;
+};
+
+JsonPath::JsonPath(const std::string& expression)
+    : _plan(std::make_shared<const Plan>(Plan{Compiler(expression).compile()}))
+{
+}
+
+JsonPath::~JsonPath() = default;
+
+//每一段作用于上一段的全部结果，递归下降时作用于结果及其所有后代
+std::vector<const Json*> JsonPath::select(const Json& root, const PathOptions& options) const
+{
+    Evaluator evaluator(root, options);
+    std::vector<const Json*> curr{&root};
+    std::vector<const Json*> next;
+    std::vector<const Json*> scope;
+    for(auto& seg : _plan->segments)
+    {
+        next.clear();
+        for(const Json* node : curr)
+        {
+            scope.clear();
+            if(seg.recursive)
+                descendants(*node, scope);
+            else
+                scope.push_back(node);
+            for(const Json* json : scope)
+            {
+                for(auto& sel : seg.selectors)
+                    evaluator.apply(sel, *json, next);
+            }
+        }
+        curr.swap(next);
+    }
+    return curr;
+}
+}//namespace LeptJson
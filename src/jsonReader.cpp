@@ -0,0 +1,284 @@
+#include<algorithm>
+#include<condition_variable>
+#include<cstdio>
+#include<cstring>
+#include<mutex>
+#include<thread>
+#include<vector>
+#ifdef LEPTJSON_HAVE_ZLIB
+#include<zlib.h>
+#endif
+#include"jsonReader.h"
+#include"parse.h"
+
+namespace LeptJson
+{
+Json parseChunked(ChunkReader reader, std::string& errMsg, const ParseOptions& options) noexcept
+{
+    try
+    {
+        Parser p(std::move(reader), options);
+        return p.parse();
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+}
+
+#ifdef LEPTJSON_HAVE_ZLIB
+namespace
+{
+//解压线程和解析线程之间的环形缓冲区
+//解压线程填满一块就交出去，解析线程读完一块就还回来，块本身不在线程间复制
+class InflateRing
+{
+public:
+    InflateRing(ChunkReader input, const GzipOptions& options)
+        : _input(std::move(input)), _slots(options.slots ? options.slots : 1)
+    {
+        for(auto& slot : _slots)
+            slot.data.resize(options.slotSize ? options.slotSize : GzipOptions().slotSize);
+        _worker = std::thread(&InflateRing::run, this);
+    }
+
+    //解析提前结束时让解压线程停下
+    ~InflateRing()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _notFull.notify_one();
+        _worker.join();
+    }
+
+    InflateRing(const InflateRing&) = delete;
+    InflateRing& operator=(const InflateRing&) = delete;
+
+public:
+    //解析线程调用，没有数据时等待，解压结束后返回0
+    size_t read(char* dest, size_t capacity)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this] {return _filled > 0 || _done;});
+        if(_filled == 0)
+            return 0;
+        Slot& slot = _slots[_head];
+        lock.unlock();
+        //已经交出的块解压线程不会再碰，可以不加锁复制
+        size_t n = std::min(capacity, slot.size - _offset);
+        memcpy(dest, slot.data.data() + _offset, n);
+        _offset += n;
+        if(_offset == slot.size)
+        {
+            _offset = 0;
+            _head = (_head + 1) % _slots.size();
+            lock.lock();
+            _filled--;
+            lock.unlock();
+            _notFull.notify_one();
+        }
+        return n;
+    }
+
+    //解压结束之前返回空串
+    std::string error()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _done ? _error : std::string();
+    }
+
+private:
+    struct Slot
+    {
+        std::vector<char> data;
+        size_t size = 0;
+    };
+
+    //解压线程：依次填满空闲的块，直到输入结束、出错或者被要求停止
+    void run()
+    {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        std::string error;
+        //窗口位加32表示自动识别gzip和zlib头
+        if(inflateInit2(&zs, 15 + 32) != Z_OK)
+        {
+            finish("INVALID GZIP: INIT FAILED");
+            return;
+        }
+        std::vector<char> input(64 * 1024);
+        bool streamEnd = false;
+        bool end = false;
+        size_t tail = 0;
+        while(!end)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _notFull.wait(lock, [this] {return _filled < _slots.size() || _stop;});
+                if(_stop)
+                    break;
+            }
+            Slot& slot = _slots[tail];
+            zs.next_out = reinterpret_cast<Bytef*>(slot.data.data());
+            zs.avail_out = static_cast<uInt>(slot.data.size());
+            while(zs.avail_out > 0)
+            {
+                if(zs.avail_in == 0)
+                {
+                    size_t n = _input(input.data(), input.size());
+                    if(n == 0)
+                    {
+                        if(!streamEnd)
+                            error = "INVALID GZIP: TRUNCATED";
+                        end = true;
+                        break;
+                    }
+                    zs.next_in = reinterpret_cast<Bytef*>(input.data());
+                    zs.avail_in = static_cast<uInt>(n);
+                }
+                //上一个成员结束后还有数据，是拼接的下一个gzip成员
+                if(streamEnd)
+                {
+                    inflateReset(&zs);
+                    streamEnd = false;
+                }
+                int ret = inflate(&zs, Z_NO_FLUSH);
+                if(ret == Z_STREAM_END)
+                {
+                    streamEnd = true;
+                }
+                else if(ret != Z_OK)
+                {
+                    error = std::string("INVALID GZIP: ") + (zs.msg ? zs.msg : "CORRUPT DATA");
+                    end = true;
+                    break;
+                }
+            }
+            size_t size = slot.data.size() - zs.avail_out;
+            if(size == 0)
+                continue;
+            slot.size = size;
+            tail = (tail + 1) % _slots.size();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _filled++;
+            }
+            _notEmpty.notify_one();
+        }
+        inflateEnd(&zs);
+        finish(error);
+    }
+
+    void finish(const std::string& error)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _error = error;
+            _done = true;
+        }
+        _notEmpty.notify_one();
+    }
+
+private:
+    ChunkReader _input;         //压缩数据，只在解压线程上调用
+    std::vector<Slot> _slots;
+    size_t _head = 0;           //解析线程正在读的块，只由解析线程修改
+    size_t _offset = 0;         //_head块中已经读过的字节数
+    size_t _filled = 0;         //已经填好还没读完的块数
+    bool _done = false;         //解压线程不会再交出新的块
+    bool _stop = false;
+    std::string _error;
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    std::thread _worker;
+};
+
+Json parseInflated(ChunkReader input, std::string& errMsg, const ParseOptions& options, const GzipOptions& gzip)
+{
+    InflateRing ring(std::move(input), gzip);
+    try
+    {
+        Parser p([&ring](char* dest, size_t capacity) {return ring.read(dest, capacity);}, options);
+        Json json = p.parse();
+        //parse()读到了输入结束，解压线程已经完成
+        std::string error = ring.error();
+        if(error.empty())
+            return json;
+        errMsg = error;
+        return Json(nullptr);
+    }
+    catch(JsonException& e)
+    {
+        //数据损坏导致的截断会表现为解析错误，解压的错误更准确
+        std::string error = ring.error();
+        errMsg = error.empty() ? e.what() : error;
+        return Json(nullptr);
+    }
+}
+}//namespace
+#endif
+
+Json parseGzip(const void* data, size_t size, std::string& errMsg, const ParseOptions& options,
+               const GzipOptions& gzip) noexcept
+{
+#ifdef LEPTJSON_HAVE_ZLIB
+    try
+    {
+        const char* p = static_cast<const char*>(data);
+        const char* end = p + size;
+        return parseInflated([p, end](char* dest, size_t capacity) mutable {
+            size_t n = std::min(capacity, static_cast<size_t>(end - p));
+            memcpy(dest, p, n);
+            p += n;
+            return n;
+        }, errMsg, options, gzip);
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+#else
+    errMsg = "GZIP NOT SUPPORTED";
+    return Json(nullptr);
+#endif
+}
+
+Json parseGzipFile(const std::string& path, std::string& errMsg, const ParseOptions& options,
+                   const GzipOptions& gzip) noexcept
+{
+#ifdef LEPTJSON_HAVE_ZLIB
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file)
+    {
+        errMsg = "CANNOT OPEN: " + path;
+        return Json(nullptr);
+    }
+    Json json;
+    try
+    {
+        json = parseInflated([file](char* dest, size_t capacity) {return fread(dest, 1, capacity, file);},
+                             errMsg, options, gzip);
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        json = Json(nullptr);
+    }
+    fclose(file);
+    return json;
+#else
+    errMsg = "GZIP NOT SUPPORTED";
+    return Json(nullptr);
+#endif
+}
+}//namespace LeptJson
@@ -0,0 +1,477 @@
+#include<cmath>
+#include<limits>
+#include<optional>
+#include<regex>
+#include<unordered_map>
+#include<vector>
+#include"jsonSchema.h"
+#include"jsonException.h"
+#include"parse.h"
+
+namespace LeptJson
+{
+//类型掩码，integer单独占一位
+enum : unsigned
+{
+    kAllowNull = 1 << 0,
+    kAllowBool = 1 << 1,
+    kAllowNumber = 1 << 2,
+    kAllowInteger = 1 << 3,
+    kAllowString = 1 << 4,
+    kAllowArray = 1 << 5,
+    kAllowObject = 1 << 6,
+    kAllowAll = 0x7F
+};
+
+//编译后的schema节点
+struct Schema::Node
+{
+    unsigned types = kAllowAll;
+    double minimum = -std::numeric_limits<double>::infinity();
+    double maximum = std::numeric_limits<double>::infinity();
+    //可以和minimum、maximum同时出现，两个边界都要检查
+    std::optional<double> exclusiveMinimum;
+    std::optional<double> exclusiveMaximum;
+    size_t minLength = 0;
+    size_t maxLength = std::numeric_limits<size_t>::max();
+    size_t minItems = 0;
+    size_t maxItems = std::numeric_limits<size_t>::max();
+    bool hasPattern = false;
+    std::regex pattern;
+    Json::_array enums;
+    std::unordered_map<std::string, Node> properties;
+    std::vector<std::string> required;
+    bool allowAdditional = true;
+    std::unique_ptr<Node> additional;
+    std::unique_ptr<Node> items;
+};
+
+namespace
+{
+void schemaError(const std::string& msg)
+{
+    throw JsonException("INVALID SCHEMA: " + msg);
+}
+
+void fail(const std::string& msg, const std::string& path)
+{
+    throw JsonException(msg + ": " + (path.empty() ? "/" : path));
+}
+
+//错误位置是JSON Pointer，key中的~和/按RFC 6901写成~0和~1
+void appendKey(std::string& path, const std::string& key)
+{
+    path += '/';
+    for(char ch : key)
+    {
+        if(ch == '~')
+            path += "~0";
+        else if(ch == '/')
+            path += "~1";
+        else
+            path += ch;
+    }
+}
+
+unsigned typeBit(const std::string& name)
+{
+    if(name == "null") return kAllowNull;
+    if(name == "boolean") return kAllowBool;
+    if(name == "number") return kAllowNumber | kAllowInteger;
+    if(name == "integer") return kAllowInteger;
+    if(name == "string") return kAllowString;
+    if(name == "array") return kAllowArray;
+    if(name == "object") return kAllowObject;
+    schemaError("unknown type " + name);
+    return 0;
+}
+
+size_t toCount(const Json& json, const char* keyword)
+{
+    if(!json.isNumber() || json.toNumber() < 0 || json.toNumber() != std::floor(json.toNumber()))
+        schemaError(std::string(keyword) + " must be a non-negative integer");
+    return static_cast<size_t>(json.toNumber());
+}
+
+double toBound(const Json& json, const char* keyword)
+{
+    if(!json.isNumber())
+        schemaError(std::string(keyword) + " must be a number");
+    return json.toNumber();
+}
+
+void compile(const Json& schema, Schema::Node& node)
+{
+    if(schema.isBool())
+    {
+        //true接受任何值，false拒绝任何值
+        node.types = schema.toBool() ? static_cast<unsigned>(kAllowAll) : 0u;
+        return;
+    }
+    if(!schema.isObject())
+        schemaError("schema must be an object or a bool");
+    for(auto& it : schema.toObject())
+    {
+        const std::string& key = it.first;
+        const Json& val = it.second;
+        if(key == "type")
+        {
+            node.types = 0;
+            if(val.isString())
+                node.types = typeBit(val.toString());
+            else if(val.isArray())
+                for(auto& e : val.toArray())
+                    node.types |= typeBit(e.isString() ? e.toString() : "");
+            else
+                schemaError("type must be a string or an array");
+        }
+        else if(key == "properties")
+        {
+            if(!val.isObject())
+                schemaError("properties must be an object");
+            for(auto& prop : val.toObject())
+                compile(prop.second, node.properties[prop.first]);
+        }
+        else if(key == "required")
+        {
+            if(!val.isArray())
+                schemaError("required must be an array");
+            for(auto& e : val.toArray())
+            {
+                if(!e.isString())
+                    schemaError("required must contain strings");
+                node.required.push_back(e.toString());
+            }
+        }
+        else if(key == "additionalProperties")
+        {
+            if(val.isBool())
+            {
+                node.allowAdditional = val.toBool();
+            }
+            else
+            {
+                node.additional = std::make_unique<Schema::Node>();
+                compile(val, *node.additional);
+            }
+        }
+        else if(key == "items")
+        {
+            node.items = std::make_unique<Schema::Node>();
+            compile(val, *node.items);
+        }
+        else if(key == "enum")
+        {
+            if(!val.isArray())
+                schemaError("enum must be an array");
+            node.enums = val.toArray();
+        }
+        else if(key == "minimum") node.minimum = toBound(val, "minimum");
+        else if(key == "exclusiveMinimum") node.exclusiveMinimum = toBound(val, "exclusiveMinimum");
+        else if(key == "maximum") node.maximum = toBound(val, "maximum");
+        else if(key == "exclusiveMaximum") node.exclusiveMaximum = toBound(val, "exclusiveMaximum");
+        else if(key == "minLength") node.minLength = toCount(val, "minLength");
+        else if(key == "maxLength") node.maxLength = toCount(val, "maxLength");
+        else if(key == "minItems") node.minItems = toCount(val, "minItems");
+        else if(key == "maxItems") node.maxItems = toCount(val, "maxItems");
+        else if(key == "pattern")
+        {
+            if(!val.isString())
+                schemaError("pattern must be a string");
+            try
+            {
+                node.pattern = std::regex(val.toString(), std::regex::ECMAScript | std::regex::optimize);
+            }
+            catch(const std::regex_error&)
+            {
+                schemaError("bad pattern " + val.toString());
+            }
+            node.hasPattern = true;
+        }
+    }
+}
+
+//按首字符判断即将读到的值的类型，不消耗输入
+JsonType leadType(char ch)
+{
+    switch(ch)
+    {
+        case 'n': return JsonType::kNull;
+        case 't':
+        case 'f': return JsonType::kBool;
+        case '"': return JsonType::kString;
+        case '[': return JsonType::kArray;
+        case '{': return JsonType::kObject;
+        default:  return JsonType::kNumber;
+    }
+}
+
+//integer要等读到数值后再判断，这里只检查其余类型
+void checkType(const Schema::Node& node, JsonType type, const std::string& path)
+{
+    unsigned bit = 0;
+    switch(type)
+    {
+        case JsonType::kNull: bit = kAllowNull; break;
+        case JsonType::kBool: bit = kAllowBool; break;
+        case JsonType::kNumber: bit = kAllowNumber | kAllowInteger; break;
+        case JsonType::kString: bit = kAllowString; break;
+        case JsonType::kArray: bit = kAllowArray; break;
+        default: bit = kAllowObject; break;
+    }
+    if(!(node.types & bit))
+        fail("TYPE MISMATCH", path);
+}
+
+void checkNumber(const Schema::Node& node, double n, const std::string& path)
+{
+    if(!(node.types & kAllowNumber) && n != std::floor(n))
+        fail("TYPE MISMATCH", path);
+    if(n < node.minimum || n > node.maximum
+        || (node.exclusiveMinimum && n <= *node.exclusiveMinimum)
+        || (node.exclusiveMaximum && n >= *node.exclusiveMaximum))
+        fail("NUMBER OUT OF RANGE", path);
+}
+
+void checkString(const Schema::Node& node, const std::string& str, const std::string& path)
+{
+    //长度按UTF-8码点计算
+    size_t len = 0;
+    for(auto ch : str)
+        if((static_cast<unsigned char>(ch) & 0xC0) != 0x80)
+            len++;
+    if(len < node.minLength || len > node.maxLength)
+        fail("STRING LENGTH OUT OF RANGE", path);
+    bool matched = true;
+    if(node.hasPattern)
+    {
+        //复杂的正则可能超出std::regex的复杂度或栈的限制
+        try
+        {
+            matched = std::regex_search(str, node.pattern);
+        }
+        catch(const std::regex_error&)
+        {
+            fail("PATTERN TOO COMPLEX", path);
+        }
+    }
+    if(!matched)
+        fail("PATTERN MISMATCH", path);
+}
+
+void checkSize(const Schema::Node& node, size_t size, const std::string& path)
+{
+    if(size < node.minItems || size > node.maxItems)
+        fail("ARRAY SIZE OUT OF RANGE", path);
+}
+
+void checkEnum(const Schema::Node& node, const Json& json, const std::string& path)
+{
+    if(node.enums.empty())
+        return;
+    for(auto& e : node.enums)
+        if(e == json)
+            return;
+    fail("NOT IN ENUM", path);
+}
+
+//对象中某个key对应的子schema，不允许额外key时报错
+const Schema::Node* propertyOf(const Schema::Node& node, const std::string& key, const std::string& path)
+{
+    auto it = node.properties.find(key);
+    if(it != node.properties.end())
+        return &it->second;
+    if(!node.allowAdditional)
+        fail("ADDITIONAL PROPERTY", path);
+    return node.additional.get();
+}
+
+void checkRequired(const Schema::Node& node, const Json::_object& obj, const std::string& path)
+{
+    for(auto& key : node.required)
+    {
+        if(obj.find(key) == obj.end())
+        {
+            std::string missing = path;
+            appendKey(missing, key);
+            fail("MISS REQUIRED", missing);
+        }
+    }
+}
+
+void validateTree(const Json& json, const Schema::Node& node, std::string& path)
+{
+    checkType(node, json.getType(), path);
+    switch(json.getType())
+    {
+        case JsonType::kNumber:
+            checkNumber(node, json.toNumber(), path);
+            break;
+        case JsonType::kString:
+            checkString(node, json.toString(), path);
+            break;
+        case JsonType::kArray:
+        {
+            checkSize(node, json.size(), path);
+            if(!node.items)
+                break;
+            size_t len = path.size();
+            for(size_t i = 0; i < json.size(); i++)
+            {
+                path += "/" + std::to_string(i);
+                validateTree(json[i], *node.items, path);
+                path.resize(len);
+            }
+            break;
+        }
+        case JsonType::kObject:
+        {
+            checkRequired(node, json.toObject(), path);
+            size_t len = path.size();
+            for(auto& it : json.toObject())
+            {
+                appendKey(path, it.first);
+                const Schema::Node* child = propertyOf(node, it.first, path);
+                if(child)
+                    validateTree(it.second, *child, path);
+                path.resize(len);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    checkEnum(node, json, path);
+}
+}//namespace
+
+Schema::Schema(const Json& schema)
+{
+    auto root = std::make_shared<Node>();
+    compile(schema, *root);
+    _root = std::move(root);
+}
+
+Schema::~Schema() = default;
+
+bool Schema::validate(const Json& json, std::string& errMsg) const noexcept
+{
+    try
+    {
+        std::string path;
+        validateTree(json, *_root, path);
+        return true;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        return false;
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        return false;
+    }
+}
+
+Json Schema::parse(const std::string& content, std::string& errMsg) const noexcept
+{
+    try
+    {
+        Parser p(content);
+        std::string path;
+        Json json = parseValue(p, _root.get(), path);
+        p.finish();
+        return json;
+    }
+    catch(JsonException& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        return Json(nullptr);
+    }
+}
+
+//读值之前先按首字符检查类型，容器在读每个子值时检查对应的子schema
+//没有约束的子树直接交给解析器
+Json Schema::parseValue(Parser& p, const Node* node, std::string& path) const
+{
+    if(!node)
+        return p.readValue();
+    JsonType type = leadType(p.peek());
+    checkType(*node, type, path);
+    Json json;
+    switch(type)
+    {
+        case JsonType::kNull:
+            p.readNull();
+            break;
+        case JsonType::kBool:
+            json = Json(p.readBool());
+            break;
+        case JsonType::kNumber:
+        {
+            double n = p.readNumber();
+            checkNumber(*node, n, path);
+            json = Json(n);
+            break;
+        }
+        case JsonType::kString:
+        {
+            std::string str = p.readString();
+            checkString(*node, str, path);
+            json = Json(std::move(str));
+            break;
+        }
+        case JsonType::kArray:
+        {
+            Json::_array arr;
+            p.expect('[', "EXPECT ARRAY");
+            if(!p.consume(']'))
+            {
+                size_t len = path.size();
+                do
+                {
+                    path += "/" + std::to_string(arr.size());
+                    arr.push_back(parseValue(p, node->items.get(), path));
+                    path.resize(len);
+                    if(arr.size() > node->maxItems)
+                        fail("ARRAY SIZE OUT OF RANGE", path);
+                } while(p.consume(','));
+                p.expect(']', "MISS COMMA OR SQUARE BRACKET");
+            }
+            checkSize(*node, arr.size(), path);
+            json = Json(std::move(arr));
+            break;
+        }
+        default:
+        {
+            Json::_object obj;
+            p.expect('{', "EXPECT OBJECT");
+            if(!p.consume('}'))
+            {
+                size_t len = path.size();
+                do
+                {
+                    std::string key = p.readString();
+                    p.expect(':', "MISS COLON");
+                    appendKey(path, key);
+                    const Node* child = propertyOf(*node, key, path);
+                    obj.insert({key, parseValue(p, child, path)});
+                    path.resize(len);
+                } while(p.consume(','));
+                p.expect('}', "MISS COMMA OR CURLY BRACKET");
+            }
+            checkRequired(*node, obj, path);
+            json = Json(std::move(obj));
+            break;
+        }
+    }
+    checkEnum(*node, json, path);
+    return json;
+}
+}//namespace LeptJson
@@ -1,8 +1,80 @@
+#include<charconv>
+#include<cmath>
+#include<cstdlib>
+#include<type_traits>
 #include"jsonValue.h"
 #include"jsonException.h"
 
 namespace LeptJson
 {
+//-0不能存成整数，否则会丢掉符号
+PackedNumbers::PackedNumbers(std::pmr::vector<double>&& values)
+    : doubles(std::move(values)), ints(doubles.get_allocator().resource()), integral(true),
+      elements(doubles.get_allocator().resource())
+{
+    constexpr double kMaxExact = 9007199254740992.0;
+    for(double val : doubles)
+    {
+        if(val != std::trunc(val) || std::fabs(val) > kMaxExact || (val == 0 && std::signbit(val)))
+        {
+            integral = false;
+            return;
+        }
+    }
+    ints.reserve(doubles.size());
+    for(double val : doubles)
+        ints.push_back(static_cast<int64_t>(val));
+    std::pmr::vector<double>(doubles.get_allocator().resource()).swap(doubles);
+}
+
+const Json::_array& PackedNumbers::materialize() const
+{
+    std::call_once(once, [this] {
+        std::pmr::memory_resource* resource = elements.get_allocator().resource();
+        elements.reserve(size());
+        for(size_t i = 0; i < size(); i++)
+            elements.emplace_back(at(i), resource);
+        ready.store(true, std::memory_order_release);
+    });
+    return elements;
+}
+
+JsonValue::JsonValue(const JsonValue& rhs, std::pmr::memory_resource* resource) : _val(nullptr)
+{
+    if(!resource)
+        resource = std::pmr::get_default_resource();
+    //PackedNumbers不能赋值，只能原地构造
+    std::visit([&](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr(std::is_same_v<T, Json::_array> || std::is_same_v<T, Json::_object> ||
+                     std::is_same_v<T, PackedNumbers>)
+            _val.emplace<T>(val, resource);
+        else
+            _val.emplace<T>(val);
+    }, rhs._val);
+}
+
+std::pmr::memory_resource* JsonValue::resource() const noexcept
+{
+    std::pmr::memory_resource* resource = nullptr;
+    if(auto arr = getArray())
+        resource = arr->get_allocator().resource();
+    else if(auto obj = getObject())
+        resource = obj->get_allocator().resource();
+    else if(auto packed = getPacked())
+        resource = packed->doubles.get_allocator().resource();
+    return resource == std::pmr::get_default_resource() ? nullptr : resource;
+}
+
+void JsonValue::unpack()
+{
+    auto packed = std::get_if<PackedNumbers>(&_val);
+    if(!packed)
+        return;
+    Json::_array arr = std::move(const_cast<Json::_array&>(packed->materialize()));
+    _val = std::move(arr);
+}
+
 //获取类型，利用variant的holds_alternative获取类型，返回相应的type
 JsonType JsonValue::getType() const noexcept
 {
@@ -10,14 +82,14 @@ JsonType JsonValue::getType() const noexcept
         return JsonType::kNull;
     else if(std::holds_alternative<bool>(_val))
         return JsonType::kBool;
-    else if(std::holds_alternative<double>(_val))
+    else if(std::holds_alternative<double>(_val) || std::holds_alternative<RawNumber>(_val))
         return JsonType::kNumber;
     else if(std::holds_alternative<std::string>(_val))
         return JsonType::kString;
-    else if(std::holds_alternative<Json::_array>(_val))
-        return JsonType::kArray;
-    else
+    else if(std::holds_alternative<Json::_object>(_val))
         return JsonType::kObject;
+    else
+        return JsonType::kArray;
 }
 
 //对于数组或对象返回其大小，即vec或map的size
@@ -27,6 +99,8 @@ size_t JsonValue::size() const
         return std::get<Json::_array>(_val).size();
     else if(std::holds_alternative<Json::_object>(_val))
         return std::get<Json::_object>(_val).size();
+    else if(auto packed = std::get_if<PackedNumbers>(&_val))
+        return packed->size();
     else
         throw JsonException("not a array or object");
 }
@@ -36,6 +110,8 @@ const Json& JsonValue::operator[](size_t pos) const
 {
     if(std::holds_alternative<Json::_array>(_val))
         return std::get<Json::_array>(_val)[pos];
+    else if(auto packed = std::get_if<PackedNumbers>(&_val))
+        return packed->materialize()[pos];
     else 
         throw JsonException("not a array");
 }
@@ -86,6 +162,9 @@ bool JsonValue::toBool() const
 
 double JsonValue::toNumber() const
 {
+    //原文已经校验过，strtod不会失败
+    if(auto raw = std::get_if<RawNumber>(&_val))
+        return strtod(raw->text.c_str(), nullptr);
     try
     {
         return std::get<double>(_val);
@@ -96,6 +175,24 @@ double JsonValue::toNumber() const
     }
 }
 
+//原文是整数时直接转换，否则转成double后要求是整数
+int64_t JsonValue::toInt64() const
+{
+    if(auto raw = std::get_if<RawNumber>(&_val))
+    {
+        int64_t val;
+        const char* end = raw->text.data() + raw->text.size();
+        auto result = std::from_chars(raw->text.data(), end, val);
+        if(result.ec == std::errc() && result.ptr == end)
+            return val;
+    }
+    double n = toNumber();
+    //2^63本身已经超出范围
+    if(n != std::trunc(n) || n < -9223372036854775808.0 || n >= 9223372036854775808.0)
+        throw JsonException("not a int64");
+    return static_cast<int64_t>(n);
+}
+
 const std::string& JsonValue::toString() const
 {
     try
@@ -110,6 +207,8 @@ const std::string& JsonValue::toString() const
 
 const Json::_array& JsonValue::toArray() const
 {
+    if(auto packed = std::get_if<PackedNumbers>(&_val))
+        return packed->materialize();
     try
     {
         return std::get<Json::_array>(_val);
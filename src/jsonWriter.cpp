@@ -0,0 +1,222 @@
+#include<algorithm>
+#include<cerrno>
+#include<climits>
+#include<ostream>
+#include<sys/uio.h>
+#include<unistd.h>
+#include"jsonWriter.h"
+
+namespace LeptJson
+{
+JsonWriter::JsonWriter(size_t bufferSize)
+    : _bufferSize(bufferSize ? bufferSize : 1)
+{
+    _buffer.reserve(_bufferSize);
+}
+
+bool JsonWriter::write(const Json& json, const SerializeOptions& options)
+{
+    if(_good)
+        json.serializeTo(_buffer, options, this);
+    return _good;
+}
+
+bool JsonWriter::write(const char* data, size_t len)
+{
+    if(_good)
+        spill(data, len);
+    return _good;
+}
+
+bool JsonWriter::flush()
+{
+    if(_good && !_buffer.empty())
+        spill();
+    if(_good)
+        _good = sync();
+    return _good;
+}
+
+void JsonWriter::finish() noexcept
+{
+    try
+    {
+        flush();
+    }
+    catch(...)
+    {
+        _good = false;
+    }
+}
+
+void JsonWriter::spill()
+{
+    if(_good)
+        _good = output(_buffer);
+    _buffer.clear();
+    //output()可能把缓冲区swap走了
+    if(_buffer.capacity() < _bufferSize)
+        _buffer.reserve(_bufferSize);
+}
+
+void JsonWriter::spill(const char* data, size_t len)
+{
+    while(_good && len > 0)
+    {
+        size_t n = std::min(len, _bufferSize - std::min(_buffer.size(), _bufferSize));
+        _buffer.append(data, n);
+        data += n;
+        len -= n;
+        if(_buffer.size() >= _bufferSize)
+            spill();
+    }
+}
+
+//写完整个缓冲区，处理被信号打断和部分写入
+static bool writeAll(int fd, const char* data, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+FdWriter::FdWriter(int fd, size_t bufferSize, size_t batch)
+    : JsonWriter(bufferSize), _fd(fd), _batch(batch ? batch : 1)
+{
+}
+
+FdWriter::~FdWriter()
+{
+    finish();
+}
+
+bool FdWriter::output(std::string& chunk)
+{
+    if(_batch == 1)
+    {
+        bool ok = writeAll(_fd, chunk.data(), chunk.size());
+        chunk.clear();
+        return ok;
+    }
+    //整块swap到待写列表里，换一块用过的缓冲区回来
+    _chunks.emplace_back();
+    _chunks.back().swap(chunk);
+    if(!_spare.empty())
+    {
+        chunk.swap(_spare.back());
+        _spare.pop_back();
+    }
+    return _chunks.size() < _batch || sync();
+}
+
+bool FdWriter::sync()
+{
+    std::vector<iovec> iov;
+    for(auto& c : _chunks)
+        iov.push_back({const_cast<char*>(c.data()), c.size()});
+    size_t i = 0;
+    bool ok = true;
+    while(i < iov.size())
+    {
+        int count = static_cast<int>(std::min<size_t>(iov.size() - i, IOV_MAX));
+        ssize_t n = ::writev(_fd, &iov[i], count);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        //跳过已经写完的块，部分写入的块调整起点
+        auto left = static_cast<size_t>(n);
+        while(i < iov.size() && left >= iov[i].iov_len)
+            left -= iov[i++].iov_len;
+        if(i < iov.size())
+        {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+            iov[i].iov_len -= left;
+        }
+    }
+    for(auto& c : _chunks)
+    {
+        c.clear();
+        _spare.push_back(std::move(c));
+    }
+    _chunks.clear();
+    return ok;
+}
+
+FileWriter::FileWriter(FILE* file, size_t bufferSize)
+    : JsonWriter(bufferSize), _file(file)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    finish();
+}
+
+bool FileWriter::output(std::string& chunk)
+{
+    bool ok = fwrite(chunk.data(), 1, chunk.size(), _file) == chunk.size();
+    chunk.clear();
+    return ok;
+}
+
+bool FileWriter::sync()
+{
+    return fflush(_file) == 0;
+}
+
+StreamWriter::StreamWriter(std::ostream& os, size_t bufferSize)
+    : JsonWriter(bufferSize), _os(os)
+{
+}
+
+StreamWriter::~StreamWriter()
+{
+    finish();
+}
+
+bool StreamWriter::output(std::string& chunk)
+{
+    _os.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    chunk.clear();
+    return static_cast<bool>(_os);
+}
+
+CallbackWriter::CallbackWriter(Callback callback, size_t bufferSize)
+    : JsonWriter(bufferSize), _callback(std::move(callback))
+{
+}
+
+CallbackWriter::~CallbackWriter()
+{
+    finish();
+}
+
+bool CallbackWriter::output(std::string& chunk)
+{
+    bool ok = _callback(chunk.data(), chunk.size());
+    chunk.clear();
+    return ok;
+}
+
+//经过StreamWriter写出，不再先拼出完整的字符串
+std::ostream& operator<<(std::ostream& os, const Json& json)
+{
+    StreamWriter writer(os, 4096);
+    writer.write(json);
+    return os;
+}
+}//namespace LeptJson
@@ -1,20 +1,115 @@
+#include<algorithm>
 #include<cassert>
 #include<cmath>
 #include<cstdio>
 #include<cstring>
 #include<stdexcept>
+#include"jsonValue.h"
 #include"parse.h"
+#include"scan.h"
 
 namespace LeptJson
 {
-//去除空白字符
-void Parser::parseWhitespace() noexcept
+Parser::Parser(const std::string& content, const ParseOptions& options)
+    : Parser(content.c_str(), content.c_str() + content.size(), options)
 {
-    while(*_curr == ' ' || *_curr == '\t' || *_curr == '\r' || *_curr == '\n')
+}
+
+//一开始缓冲区为空，第一次parseWhitespace()时读入
+Parser::Parser(ChunkReader reader, const ParseOptions& options) : Parser("", "", options)
+{
+    _reader = std::move(reader);
+}
+
+//把字段路径编译成前缀树
+Parser::Parser(const char* begin, const char* end, const ParseOptions& options)
+    : _start(begin), _curr(begin), _end(end),
+      _resource(options.resource), _stats(options.stats), _maxDepth(options.maxDepth), _strictUtf8(options.strictUtf8),
+      _packNumbers(options.packNumbers && !options.rawNumbers), _rawNumbers(options.rawNumbers)
+{
+    if(options.fields.empty())
+        return;
+    _projection = std::make_unique<Projection>();
+    for(auto& path : options.fields)
     {
-        _curr++;
+        Projection* node = _projection.get();
+        size_t begin = 0;
+        while(!node->all)
+        {
+            size_t end = path.find('.', begin);
+            node = &node->children[path.substr(begin, end - begin)];
+            if(end == std::string::npos)
+                break;
+            begin = end + 1;
+        }
+        node->all = true;
+        node->children.clear();
     }
-    _start = _curr;
+    _select = _projection.get();
+}
+
+//去除空白字符，分块输入时顺便保证下一个token的前kLookahead个字节可读
+void Parser::parseWhitespace()
+{
+    LEPTJSON_TIMER(whitespaceCycles);
+    while(1)
+    {
+        [[maybe_unused]] const char* begin = _curr;
+        while(*_curr == ' ' || *_curr == '\t' || *_curr == '\r' || *_curr == '\n')
+        {
+            _curr++;
+        }
+        LEPTJSON_STAT(whitespaceBytes += _curr - begin);
+        _start = _curr;
+        if(_curr != _end || !fill())
+            break;
+    }
+    ensure(kLookahead);
+}
+
+//分块输入时读入下一块，[_start, _end)之间还没处理完的内容移到缓冲区开头
+//缓冲区只在单个token比一块还长时扩大，读到了新数据时返回true
+bool Parser::fill()
+{
+    if(!_reader || _eof)
+        return false;
+    size_t keep = _end - _start;
+    size_t offset = _curr - _start;
+    if(_window.size() < keep + kChunkSize + 1)
+    {
+        //_start可能指向旧的缓冲区，先复制再交换
+        std::string window(std::max(keep + kChunkSize + 1, 2 * _window.size()), '\0');
+        memcpy(&window[0], _start, keep);
+        _window.swap(window);
+    }
+    else
+    {
+        memmove(&_window[0], _start, keep);
+    }
+    size_t n = _reader(&_window[keep], _window.size() - keep - 1);
+    _eof = n == 0;
+    _start = _window.data();
+    _curr = _start + offset;
+    _end = _start + keep + n;
+    _window[keep + n] = '\0';
+    return n > 0;
+}
+
+//[begin, end)结尾被截断的多字节序列的起点，没有截断时返回end
+static const char* partialUtf8(const char* begin, const char* end) noexcept
+{
+    for(const char* p = end; p > begin && end - p < 4; )
+    {
+        auto ch = static_cast<unsigned char>(*--p);
+        if(ch < 0x80)
+            return end;
+        if(ch >= 0xC0)
+        {
+            long len = ch >= 0xF0 ? 4 : ch >= 0xE0 ? 3 : 2;
+            return end - p < len ? p : end;
+        }
+    }
+    return end;
 }
 
 //把四组4位十六进制数转换为二进制
@@ -68,16 +163,51 @@ std::string Parser::encodeUTF8(unsigned u) noexcept
 std::string Parser::parseRawString()
 {
     std::string str;
+    parseRawString(str);
+    return str;
+}
+
+//普通字符成段扫描后整段追加到str，只在引号、转义和控制字符处停下
+void Parser::parseRawString(std::string& str)
+{
+    LEPTJSON_TIMER(stringCycles);
+    ++_curr;
     while(1)
     {
-        switch(*++_curr)
+        const char* run = _curr;
+        _curr = scanStringRun(_curr, _end);
+        //分块输入读到缓冲区末尾时，结尾不完整的多字节序列留到补充数据之后
+        bool refill = _curr == _end && _reader;
+        if(refill)
+            _curr = partialUtf8(run, _curr);
+        if(_curr != run)
+        {
+            //段的边界都是ASCII字符或完整序列的末尾，不会切断多字节序列，可以逐段校验
+            if(_strictUtf8 && !isValidUtf8(run, _curr))
+                error("INVALID UTF8");
+            str.append(run, _curr);
+        }
+        if(refill)
+        {
+            //已经读到的部分不再保留在缓冲区里
+            LEPTJSON_STAT(stringBytes += _curr - _start);
+            _start = _curr;
+            if(fill())
+                continue;
+            error("MISS QUOTATION MARK");
+        }
+        switch(*_curr)
         {
             case '\"':
-                _start = ++_curr;
-                return str;
+                ++_curr;
+                LEPTJSON_STAT(stringBytes += _curr - _start);
+                _start = _curr;
+                return;
             case '\0':
                 error("MISS QUOTATION MARK");
             case '\\':
+                //最长的转义是一对代理项，共12个字节
+                ensure(12);
                 switch(*++_curr)
                 {
                     case '\"': str.push_back('\"');break;
@@ -102,16 +232,18 @@ std::string Parser::parseRawString()
                                 error("INVALID UNICODE SURROGATE");
                             u1 = (((u1 - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
                         }
+                        else if(_strictUtf8 && u1 >= 0xDC00 && u1 <= 0xDFFF)
+                        {
+                            error("INVALID UNICODE SURROGATE");
+                        }
                         str += encodeUTF8(u1);
                     }break;
                     default: error("INVALID STRING ESCAPE");
                 }
+                ++_curr;
                 break;
             default:
-                if(static_cast<unsigned char>(*_curr) < 0x20)
-                    error("INVALID STRING CHAR");
-                str.push_back(*_curr);
-                break;
+                error("INVALID STRING CHAR");
         }
     }
 }
@@ -121,37 +253,294 @@ void Parser::error(const std::string& msg) const
     throw JsonException(msg + ": " + _start);
 }
 
+//解析一个值，容器用显式栈代替递归，嵌套深度只受maxDepth限制
 Json Parser::parseValue()
 {
-    switch(*_curr)
+    const size_t base = _stack.size();
+    const Projection* select = _select;
+    while(1)
+    {
+        Json value = beginValue();
+        //把完成的值交给栈顶容器，容器结束时再作为值继续向上交付
+        while(1)
+        {
+            if(_stack.size() == base)
+            {
+                _select = select;
+                return value;
+            }
+            Frame& top = _stack.back();
+            if(top.isObject)
+                addMember(top, std::move(value));
+            else
+                top.arr.push_back(std::move(value));
+            parseWhitespace();
+            if(*_curr == ',')
+            {
+                ++_curr;
+                parseWhitespace();
+                if(!top.isObject)
+                {
+                    _select = top.select;
+                    break;
+                }
+                if(nextKey(top))
+                    break;
+                value = closeContainer();
+            }
+            else if(*_curr == (top.isObject ? '}' : ']'))
+            {
+                _start = ++_curr;
+                value = closeContainer();
+            }
+            else
+            {
+                error(top.isObject ? "MISS COMMA OR CURLY BRACKET" : "MISS COMMA OR SQUARE BRACKET");
+            }
+        }
+    }
+}
+
+//读到第一个完整的值为止，途中遇到的非空容器入栈，之后从它们的第一个元素继续
+Json Parser::beginValue()
+{
+    while(1)
+    {
+        switch(*_curr)
+        {
+            case 'n':  return parseLiteral("null");
+            case 't':  return parseLiteral("true");
+            case 'f':  return parseLiteral("false");
+            case '\"': return parseString();
+            case '[':
+                openContainer(false);
+                if(*_curr == ']')
+                {
+                    _start = ++_curr;
+                    return closeContainer();
+                }
+                _select = _stack.back().select;
+                if(_stack.back().packing && packNumbers(_stack.back()))
+                    return closeContainer();
+                break;
+            case '{':
+                openContainer(true);
+                if(*_curr == '}')
+                {
+                    _start = ++_curr;
+                    return closeContainer();
+                }
+                if(!nextKey(_stack.back()))
+                    return closeContainer();
+                break;
+            case '\0': error("EXPECT VALUE");
+            default:   return parseNumber();
+        }
+    }
+}
+
+void Parser::openContainer(bool object)
+{
+    if(_stack.size() >= _maxDepth)
+        error("NESTING TOO DEEP");
+    _stack.emplace_back(object, _select, _resource ? _resource : std::pmr::get_default_resource(),
+                        !object && _packNumbers);
+    if(_pool)
+    {
+        //回收的容器已经清空，借用它的缓冲区，结束时再还回节点
+        Frame& top = _stack.back();
+        top.node = _pool->take(object ? JsonType::kObject : JsonType::kArray);
+        if(object)
+            top.obj = std::move(*top.node->getObject());
+        else
+            top.arr = std::move(*top.node->getArray());
+    }
+    if(object)
+        LEPTJSON_STAT(objects++);
+    else
+        LEPTJSON_STAT(arrays++);
+    LEPTJSON_STAT(maxDepth = std::max(_stats->maxDepth, _stack.size()));
+    ++_curr;
+    parseWhitespace();
+}
+
+Json Parser::closeContainer()
+{
+    Frame& top = _stack.back();
+    if(top.node && !(top.packing && !top.numbers.empty()))
+    {
+        //这次没有出现的key
+        if(top.isObject && top.filled != top.obj.size())
+        {
+            for(auto it = top.obj.begin(); it != top.obj.end();)
+                it = NodePool::vacant(it->second) ? top.obj.erase(it) : std::next(it);
+        }
+        if(top.isObject)
+            top.node->assign(std::move(top.obj));
+        else
+            top.node->assign(std::move(top.arr));
+        Json json = NodePool::wrap(std::move(top.node));
+        _stack.pop_back();
+        return json;
+    }
+    if(top.node)
+    {
+        //紧凑数组不用这个节点，连同借来的缓冲区一起还回去
+        top.node->assign(std::move(top.arr));
+        _pool->arrays.push_back(std::move(top.node));
+    }
+    Json json = top.isObject ? Json(std::move(top.obj), _resource)
+              : top.packing && !top.numbers.empty() ? Json::fromNumbers(std::move(top.numbers), _resource)
+              : Json(std::move(top.arr), _resource);
+    _stack.pop_back();
+    return json;
+}
+
+//数组开头的连续数字直接读进numbers，不创建节点，整个数组读完时返回true
+//遇到其他类型的元素时把已经读到的数字转成普通元素，之后按普通数组解析
+bool Parser::packNumbers(Frame& frame)
+{
+    while(*_curr == '-' || is0to9(*_curr))
+    {
+        frame.numbers.push_back(parseRawNumber());
+        parseWhitespace();
+        if(*_curr == ',')
+        {
+            ++_curr;
+            parseWhitespace();
+        }
+        else if(*_curr == ']')
+        {
+            _start = ++_curr;
+            return true;
+        }
+        else
+        {
+            error("MISS COMMA OR SQUARE BRACKET");
+        }
+    }
+    frame.packing = false;
+    frame.arr.reserve(frame.numbers.size());
+    for(double n : frame.numbers)
+        frame.arr.push_back(Json(n, _resource));
+    frame.numbers.clear();
+    return false;
+}
+
+//读取对象的下一个key和冒号，之后可以解析对应的值
+//有字段投影时未选中的key连同值一起跳过，对象因此结束时返回false
+bool Parser::nextKey(Frame& frame)
+{
+    while(1)
+    {
+        if(*_curr != '"')
+            error("MISS KEY");
+        std::string key = parseRawString();
+        LEPTJSON_STAT(keys++);
+        parseWhitespace();
+        if(*_curr++ != ':')
+            error("MISS COLON");
+        parseWhitespace();
+        if(!frame.select)
+        {
+            frame.key = std::move(key);
+            _select = nullptr;
+            return true;
+        }
+        auto it = frame.select->children.find(key);
+        if(it != frame.select->children.end())
+        {
+            frame.key = std::move(key);
+            _select = it->second.all ? nullptr : &it->second;
+            return true;
+        }
+        skipValue();
+        parseWhitespace();
+        if(*_curr == ',')
+        {
+            ++_curr;
+            parseWhitespace();
+        }
+        else if(*_curr == '}')
+        {
+            _start = ++_curr;
+            return false;
+        }
+        else
+        {
+            error("MISS COMMA OR CURLY BRACKET");
+        }
+    }
+}
+
+//对象的成员，重复的key保留第一个值
+//回收的对象里已经有这个key时直接填进原来的成员，不分配新的节点
+void Parser::addMember(Frame& frame, Json value)
+{
+    if(!_pool)
     {
-        case 'n':  return parseLiteral("null");
-        case 't':  return parseLiteral("true");
-        case 'f':  return parseLiteral("false");
-        case '\"': return parseString();
-        case '[':  return parseArray();
-        case '{':  return parseObject();
-        case '\0': error("EXPECT VALUE");
-        default:   return parseNumber();
+        frame.obj.emplace(std::move(frame.key), std::move(value));
+        return;
+    }
+    auto it = frame.obj.find(frame.key);
+    if(it == frame.obj.end())
+    {
+        frame.obj.emplace(std::move(frame.key), std::move(value));
+        frame.filled++;
+    }
+    else if(NodePool::vacant(it->second))
+    {
+        it->second = std::move(value);
+        frame.filled++;
     }
 }
 
+template<class T>
+Json Parser::makeScalar(T val)
+{
+    std::shared_ptr<JsonValue> node;
+    if(_pool)
+    {
+        node = _pool->take(JsonType::kNull);
+        node->assign(std::move(val));
+    }
+    else if(_resource)
+    {
+        node = std::allocate_shared<JsonValue>(std::pmr::polymorphic_allocator<JsonValue>(_resource), std::move(val));
+    }
+    else
+    {
+        node = std::make_shared<JsonValue>(std::move(val));
+    }
+    return NodePool::wrap(std::move(node));
+}
+
 Json Parser::parseLiteral(const std::string& literal)
 {
+    LEPTJSON_TIMER(literalCycles);
     if(strncmp(_curr, literal.c_str(), literal.size()) != 0)
         error("INVALID VALUE");
     _curr += literal.size();
+    LEPTJSON_STAT(literalBytes += literal.size());
+    if(literal[0] == 'n')
+        LEPTJSON_STAT(nulls++);
+    else
+        LEPTJSON_STAT(bools++);
     _start = _curr;
     switch(literal[0])
     {
-        case 't': return Json(true);
-        case 'f': return Json(false);
-        default:  return Json(nullptr);
+        case 't': return makeScalar(true);
+        case 'f': return makeScalar(false);
+        default:  return makeScalar(nullptr);
     }
 }
 
-Json Parser::parseNumber()
+//校验数字的语法，结束后数字是[_start, _curr)
+void Parser::scanNumber()
 {
+    //分块输入时先把整个数字读进缓冲区，校验和转换都需要连续的文本
+    while(_reader && _start + strspn(_start, "+-.0123456789Ee") == _end && fill())
+        ;
     if(*_curr == '-')
         ++_curr;
     if(*_curr == '0')
@@ -182,95 +571,283 @@ Json Parser::parseNumber()
         while(is0to9(*++_curr))
             ; 
     }
+}
+
+double Parser::parseRawNumber()
+{
+    LEPTJSON_TIMER(numberCycles);
+    scanNumber();
     double n = strtod(_start, nullptr);
     if(fabs(n) == HUGE_VAL)
         error("NUMBER TOO BIG");
+    LEPTJSON_STAT(numbers++);
+    LEPTJSON_STAT(numberBytes += _curr - _start);
+    _start = _curr;
+    return n;
+}
+
+Json Parser::parseNumber()
+{
+    if(!_rawNumbers)
+        return makeScalar(parseRawNumber());
+    LEPTJSON_TIMER(numberCycles);
+    scanNumber();
+    RawNumber raw{std::string(_start, _curr)};
+    LEPTJSON_STAT(numbers++);
+    LEPTJSON_STAT(numberBytes += _curr - _start);
     _start = _curr;
-    return Json(n);
+    return makeScalar(std::move(raw));
 }
 
 Json Parser::parseString()
 {
-    return Json(parseRawString());
+    LEPTJSON_STAT(strings++);
+    if(!_pool)
+        return Json(parseRawString(), _resource);
+    std::shared_ptr<JsonValue> node = _pool->take(JsonType::kString);
+    parseRawString(*node->getString());
+    return NodePool::wrap(std::move(node));
 }
 
-Json Parser::parseArray()
+Json Parser::parse()
 {
-    Json::_array arr;
-    ++_curr;
+    LEPTJSON_TIMER(totalCycles);
     parseWhitespace();
-    if(*_curr == ']')
-    {
-        _start = ++_curr;
-        return Json(arr);
-    }
-    while(1)
+    Json json = parseValue();
+    parseWhitespace();
+    if(*_curr)
+        error("ROOT NOT SINGULAR");
+    return json;
+}
+
+//按先序收集，解析时也按先序取用，形状相同时各个节点大多回到原来的位置
+void NodePool::collect(Json& root)
+{
+    std::vector<std::shared_ptr<JsonValue>> stack;
+    stack.push_back(std::move(root._jsonValue));
+    std::pmr::memory_resource* heap = std::pmr::get_default_resource();
+    while(!stack.empty())
     {
-        parseWhitespace();
-        arr.push_back(parseValue());
-        parseWhitespace();
-        if(*_curr == ',')
+        std::shared_ptr<JsonValue> node = std::move(stack.back());
+        stack.pop_back();
+        //和其他Json共享的节点不能改写
+        if(!node || node.use_count() != 1)
+            continue;
+        if(Json::_array* arr = node->getArray())
         {
-            ++_curr;
+            if(arr->get_allocator().resource() != heap)
+                continue;
+            for(auto it = arr->rbegin(); it != arr->rend(); ++it)
+                stack.push_back(std::move(it->_jsonValue));
+            arr->clear();
+            arrays.push_back(std::move(node));
         }
-        else if(*_curr == ']')
+        else if(Json::_object* obj = node->getObject())
         {
-            _start = ++_curr;
-            return Json(arr);
+            if(obj->get_allocator().resource() != heap)
+                continue;
+            for(auto& member : *obj)
+                stack.push_back(std::move(member.second._jsonValue));
+            objects.push_back(std::move(node));
+        }
+        else if(std::string* str = node->getString())
+        {
+            str->clear();
+            strings.push_back(std::move(node));
         }
         else
         {
-            error("MISS COMMA OR SQUARE BRACKET");
+            scalars.push_back(std::move(node));
         }
     }
+    //take()从末尾取
+    for(auto* list : {&scalars, &strings, &arrays, &objects})
+        std::reverse(list->begin(), list->end());
 }
 
-Json Parser::parseObject()
+std::shared_ptr<JsonValue> NodePool::take(JsonType type)
 {
-    Json::_object obj;
-    ++_curr;
-    parseWhitespace();
-    if(*_curr == '}')
+    std::vector<std::shared_ptr<JsonValue>>& list = type == JsonType::kString ? strings
+                                                  : type == JsonType::kArray ? arrays
+                                                  : type == JsonType::kObject ? objects
+                                                  : scalars;
+    if(list.empty())
     {
-        _start = ++_curr;
-        return Json(obj);
+        switch(type)
+        {
+            case JsonType::kString: return std::make_shared<JsonValue>(std::string());
+            case JsonType::kArray:  return std::make_shared<JsonValue>(Json::_array());
+            case JsonType::kObject: return std::make_shared<JsonValue>(Json::_object());
+            default:                return std::make_shared<JsonValue>(nullptr);
+        }
     }
+    std::shared_ptr<JsonValue> node = std::move(list.back());
+    list.pop_back();
+    node->recycle();
+    return node;
+}
+
+//跳过空白后查看下一个字符
+char Parser::peek()
+{
+    parseWhitespace();
+    return *_curr;
+}
+
+//下一个字符是ch时吃掉它
+bool Parser::consume(char ch)
+{
+    if(peek() != ch)
+        return false;
+    _start = ++_curr;
+    return true;
+}
+
+//下一个字符必须是ch，否则以msg报错
+void Parser::expect(char ch, const std::string& msg)
+{
+    if(!consume(ch))
+        error(msg);
+}
+
+std::string Parser::readString()
+{
+    if(peek() != '"')
+        error("EXPECT STRING");
+    return parseRawString();
+}
+
+double Parser::readNumber()
+{
+    char ch = peek();
+    if(ch != '-' && !is0to9(ch))
+        error("EXPECT NUMBER");
+    return parseRawNumber();
+}
+
+//字面量直接比较，不构造Json
+bool Parser::readBool()
+{
+    bool val = peek() == 't';
+    const char* literal = val ? "true" : "false";
+    size_t len = val ? 4 : 5;
+    if(strncmp(_curr, literal, len) != 0)
+        error("EXPECT BOOL");
+    _curr += len;
+    _start = _curr;
+    return val;
+}
+
+void Parser::readNull()
+{
+    if(peek() != 'n' || strncmp(_curr, "null", 4) != 0)
+        error("EXPECT NULL");
+    _curr += 4;
+    _start = _curr;
+}
+
+Json Parser::readValue()
+{
+    parseWhitespace();
+    return parseValue();
+}
+
+//跳过字符串，只找未转义的右引号，不解码
+void Parser::skipRawString()
+{
+    ++_curr;
     while(1)
     {
-        parseWhitespace();
-        if(*_curr != '"')
-            error("MISS KEY");
-        std::string key = parseRawString();
-        parseWhitespace();
-        if(*_curr++ != ':')
-            error("MISS COLON");
-        parseWhitespace();
-        Json val = parseValue();
-        obj.insert({key, val});
-        parseWhitespace();
-        if(*_curr == ',')
+        _curr += strcspn(_curr, "\"\\");
+        switch(*_curr)
         {
-            ++_curr;
+            case '\"':
+                _start = ++_curr;
+                return;
+            case '\\':
+                ensure(2);
+                if(*++_curr)
+                {
+                    ++_curr;
+                    break;
+                }
+                //反斜杠在末尾，落入缺少引号的错误
+                [[fallthrough]];
+            default:
+                //分块输入时跳过的内容不保留
+                _start = _curr;
+                if(_curr == _end && fill())
+                    break;
+                error("MISS QUOTATION MARK");
         }
-        else if(*_curr == '}')
+    }
+}
+
+//丢弃一个不需要的值，只做引号和括号匹配，不构造也不完整校验
+void Parser::skipValue()
+{
+    switch(peek())
+    {
+        case '\"':
+            skipRawString();
+            return;
+        case '[':
+        case '{':
         {
-            _start = ++_curr;
-            return Json(obj);
+            size_t depth = 0;
+            while(1)
+            {
+                switch(*_curr)
+                {
+                    case '\"':
+                        skipRawString();
+                        break;
+                    case '[':
+                    case '{':
+                        ++depth;
+                        ++_curr;
+                        break;
+                    case ']':
+                    case '}':
+                        ++_curr;
+                        if(--depth == 0)
+                        {
+                            _start = _curr;
+                            return;
+                        }
+                        break;
+                    case '\0':
+                        _start = _curr;
+                        if(_curr == _end && fill())
+                            break;
+                        error("MISS CLOSING BRACKET");
+                    default:
+                        _curr += strcspn(_curr, "\"[]{}");
+                        break;
+                }
+            }
         }
-        else
+        case '\0':
+            error("EXPECT VALUE");
+        default:
         {
-            error("MISS COMMA OR CURLY BRACKET");
+            //字面量和数字，读到分隔符为止
+            size_t len;
+            while((len = strcspn(_curr, ",]} \t\r\n")) == static_cast<size_t>(_end - _curr) && fill())
+                ;
+            if(len == 0)
+                error("INVALID VALUE");
+            _curr += len;
+            _start = _curr;
+            return;
         }
-    }   
+    }
 }
 
-Json Parser::parse()
+//读取结束后只能剩下空白
+void Parser::finish()
 {
-    parseWhitespace();
-    Json json = parseValue();
-    parseWhitespace();
-    if(*_curr)
+    if(peek())
         error("ROOT NOT SINGULAR");
-    return json;
 }
 }//namespace LeptJson
\ No newline at end of file
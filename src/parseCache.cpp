@@ -0,0 +1,90 @@
+#include<algorithm>
+#include<functional>
+#include<string_view>
+#include"parseCache.h"
+
+namespace LeptJson
+{
+//容量分到各分片，各分片容量之和正好是capacity，分片数不超过容量，每个分片至少放一个文档
+//capacity为0时只有一个容量为0的分片，不缓存
+ParseCache::ParseCache(size_t capacity, size_t shardCount)
+{
+    shardCount = std::max<size_t>(std::min(shardCount, capacity), 1);
+    for(size_t i = 0; i < shardCount; i++)
+    {
+        _shards.push_back(std::make_unique<Shard>());
+        _shards.back()->capacity = capacity / shardCount + (i < capacity % shardCount ? 1 : 0);
+    }
+}
+
+//先在锁内查找，未命中时在锁外解析，避免长时间持锁
+//哈希冲突时比较原文，不同内容视为未命中并替换旧项
+std::shared_ptr<const Json> ParseCache::parse(const std::string& content, std::string& errMsg)
+{
+    size_t hash = std::hash<std::string_view>()(content);
+    Shard& shard = shardOf(hash);
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.index.find(hash);
+        if(it != shard.index.end() && it->second->content == content)
+        {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second->json;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+
+    std::string err;
+    Json json = Json::parse(content, err);
+    if(!err.empty())
+    {
+        errMsg = err;
+        return nullptr;
+    }
+    auto doc = std::make_shared<const Json>(std::move(json));
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(hash);
+    if(it != shard.index.end())
+    {
+        //其他线程可能已经插入了同样的内容
+        if(it->second->content == content)
+        {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return it->second->json;
+        }
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.lru.push_front(Entry{hash, content, doc});
+    shard.index[hash] = shard.lru.begin();
+    if(shard.lru.size() > shard.capacity)
+    {
+        shard.index.erase(shard.lru.back().hash);
+        shard.lru.pop_back();
+    }
+    return doc;
+}
+
+size_t ParseCache::size() const
+{
+    size_t total = 0;
+    for(auto& shard : _shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        total += shard->lru.size();
+    }
+    return total;
+}
+
+void ParseCache::clear()
+{
+    for(auto& shard : _shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        shard->index.clear();
+        shard->lru.clear();
+    }
+}
+}//namespace LeptJson
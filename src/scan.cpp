@@ -0,0 +1,109 @@
+#include"scan.h"
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
+
+namespace LeptJson
+{
+//找到第一个引号、反斜杠或控制字符，可选地还包括非ASCII字符和/
+template<bool kNonAscii, bool kSlash>
+static const char* scanSpecial(const char* p, const char* end) noexcept
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i slash = _mm_set1_epi8('/');
+    for(; p + 16 <= end; p += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        //无符号比较x <= 0x1F等价于max(x, 0x1F) == 0x1F
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        if(kSlash)
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(chunk, slash));
+        int mask = _mm_movemask_epi8(special);
+        //最高位就是非ASCII字符
+        if(kNonAscii)
+            mask |= _mm_movemask_epi8(chunk);
+        if(mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    for(; p < end; p++)
+    {
+        unsigned char ch = static_cast<unsigned char>(*p);
+        if(ch == '"' || ch == '\\' || ch < 0x20 || (kNonAscii && ch >= 0x80) || (kSlash && ch == '/'))
+            return p;
+    }
+    return end;
+}
+
+const char* scanStringRun(const char* p, const char* end) noexcept
+{
+    return scanSpecial<false, false>(p, end);
+}
+
+const char* scanEscapeRun(const char* p, const char* end, bool nonAscii, bool slash) noexcept
+{
+    if(nonAscii)
+        return slash ? scanSpecial<true, true>(p, end) : scanSpecial<true, false>(p, end);
+    return slash ? scanSpecial<false, true>(p, end) : scanSpecial<false, false>(p, end);
+}
+
+bool isValidUtf8(const char* begin, const char* end) noexcept
+{
+    auto p = reinterpret_cast<const unsigned char*>(begin);
+    auto last = reinterpret_cast<const unsigned char*>(end);
+    auto isCont = [](unsigned char ch) {return (ch & 0xC0) == 0x80;};
+    while(p < last)
+    {
+#ifdef __SSE2__
+        //整块都是ASCII时一次跳过
+        if(p + 16 <= last && !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))))
+        {
+            p += 16;
+            continue;
+        }
+#endif
+        unsigned char ch = *p;
+        if(ch < 0x80)
+        {
+            p++;
+        }
+        else if(ch < 0xC2)
+        {
+            //单独的后续字节，或者C0/C1开头的超长编码
+            return false;
+        }
+        else if(ch < 0xE0)
+        {
+            if(last - p < 2 || !isCont(p[1]))
+                return false;
+            p += 2;
+        }
+        else if(ch < 0xF0)
+        {
+            //E0后面不能小于A0(超长)，ED后面不能大于9F(代理区)
+            if(last - p < 3 || !isCont(p[1]) || !isCont(p[2])
+                || (ch == 0xE0 && p[1] < 0xA0) || (ch == 0xED && p[1] > 0x9F))
+                return false;
+            p += 3;
+        }
+        else if(ch < 0xF5)
+        {
+            //F0后面不能小于90(超长)，F4后面不能大于8F(超过U+10FFFF)
+            if(last - p < 4 || !isCont(p[1]) || !isCont(p[2]) || !isCont(p[3])
+                || (ch == 0xF0 && p[1] < 0x90) || (ch == 0xF4 && p[1] > 0x8F))
+                return false;
+            p += 4;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}//namespace LeptJson
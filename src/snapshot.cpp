@@ -0,0 +1,476 @@
+#include<algorithm>
+#include<cstdio>
+#include<cstring>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<unordered_map>
+#include<vector>
+#include"jsonException.h"
+#include"jsonValue.h"
+#include"snapshot.h"
+
+namespace LeptJson
+{
+static const char kMagic[8] = {'L', 'E', 'P', 'T', 'S', 'N', 'A', 'P'};
+static constexpr uint64_t kEndianTag = 0x0102030405060708ull;
+
+//8字节一组的FNV-1a变体，尾部不足8字节的逐字节处理
+static uint64_t checksum(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    for(; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for(; i < size; i++)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    return hash;
+}
+
+static void corrupt()
+{
+    throw JsonException("CORRUPT SNAPSHOT");
+}
+
+//用显式栈遍历，节点下标在父节点写子节点表时就分配好，之后再填内容
+//紧凑数组直接写出数字节点，不构造元素
+std::string Snapshot::build(const Json& json)
+{
+    std::vector<SnapshotNode> nodes(1);
+    std::vector<uint64_t> words;
+    std::string strings;
+    std::unordered_map<std::string, uint64_t> keys;
+    auto addKey = [&](const std::string& key) {
+        auto it = keys.find(key);
+        if(it != keys.end())
+            return it->second;
+        uint64_t offset = strings.size();
+        strings += key;
+        keys.emplace(key, offset);
+        return offset;
+    };
+    auto numberNode = [](double val) {
+        SnapshotNode node{static_cast<uint32_t>(JsonType::kNumber), 0, 0, 0};
+        memcpy(&node.a, &val, sizeof(val));
+        return node;
+    };
+
+    std::vector<std::pair<const Json*, uint64_t>> pending{{&json, 0}};
+    while(!pending.empty())
+    {
+        const Json& curr = *pending.back().first;
+        uint64_t index = pending.back().second;
+        pending.pop_back();
+        SnapshotNode node{static_cast<uint32_t>(curr.getType()), 0, 0, 0};
+        switch(curr.getType())
+        {
+            case JsonType::kNull:
+                break;
+            case JsonType::kBool:
+                node.a = curr.toBool();
+                break;
+            case JsonType::kNumber:
+                node = numberNode(curr.toNumber());
+                //保留数字原文，toJson()时还原
+                if(auto raw = curr.rawNumber(); raw && raw->size() <= UINT32_MAX)
+                {
+                    node.b = strings.size();
+                    node.c = static_cast<uint32_t>(raw->size());
+                    strings += *raw;
+                }
+                break;
+            case JsonType::kString:
+                node.a = strings.size();
+                node.b = curr.toString().size();
+                strings += curr.toString();
+                break;
+            case JsonType::kArray:
+                node.a = curr.size();
+                node.b = words.size();
+                if(curr.isPacked())
+                {
+                    Span<double> doubles = curr.packedDoubles();
+                    Span<int64_t> ints = curr.packedInts();
+                    for(size_t i = 0; i < node.a; i++)
+                    {
+                        words.push_back(nodes.size());
+                        nodes.push_back(numberNode(doubles.empty() ? static_cast<double>(ints[i]) : doubles[i]));
+                    }
+                    break;
+                }
+                for(auto& e : curr.toArray())
+                {
+                    words.push_back(nodes.size());
+                    pending.push_back({&e, nodes.size()});
+                    nodes.emplace_back();
+                }
+                break;
+            default:
+            {
+                node.a = curr.size();
+                node.b = words.size();
+                std::vector<const Json::_object::value_type*> members;
+                members.reserve(curr.size());
+                for(auto& it : curr.toObject())
+                    members.push_back(&it);
+                std::sort(members.begin(), members.end(), [](auto lhs, auto rhs) {return lhs->first < rhs->first;});
+                for(auto member : members)
+                {
+                    words.push_back(addKey(member->first));
+                    words.push_back(member->first.size());
+                    words.push_back(nodes.size());
+                    pending.push_back({&member->second, nodes.size()});
+                    nodes.emplace_back();
+                }
+                break;
+            }
+        }
+        nodes[index] = node;
+    }
+
+    SnapshotHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSnapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.endianTag = kEndianTag;
+    header.nodeCount = nodes.size();
+    header.wordCount = words.size();
+    header.stringBytes = strings.size();
+    std::string res(sizeof(header), '\0');
+    res.append(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(SnapshotNode));
+    res.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+    res += strings;
+    header.checksum = checksum(res.data() + sizeof(header), res.size() - sizeof(header));
+    memcpy(&res[0], &header, sizeof(header));
+    return res;
+}
+
+bool Snapshot::save(const Json& json, const std::string& path, std::string& errMsg) noexcept
+{
+    try
+    {
+        std::string content = build(json);
+        FILE* file = fopen(path.c_str(), "wb");
+        if(!file)
+        {
+            errMsg = "CANNOT WRITE: " + path;
+            return false;
+        }
+        bool ok = fwrite(content.data(), 1, content.size(), file) == content.size();
+        ok = fclose(file) == 0 && ok;
+        if(!ok)
+            errMsg = "CANNOT WRITE: " + path;
+        return ok;
+    }
+    catch(std::exception& e)
+    {
+        errMsg = e.what();
+        return false;
+    }
+}
+
+Snapshot::Snapshot(const char* data, size_t size, bool mapped) noexcept
+    : _data(data), _size(size), _mapped(mapped)
+{
+}
+
+Snapshot::~Snapshot()
+{
+    if(_mapped)
+        munmap(const_cast<char*>(_data), _size);
+}
+
+std::unique_ptr<Snapshot> Snapshot::open(const std::string& path, std::string& errMsg, bool verifyChecksum) noexcept
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        errMsg = "CANNOT OPEN: " + path;
+        return nullptr;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader)))
+    {
+        ::close(fd);
+        errMsg = "NOT A SNAPSHOT: " + path;
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+        errMsg = "CANNOT MAP: " + path;
+        return nullptr;
+    }
+    std::unique_ptr<Snapshot> snapshot(new Snapshot(static_cast<const char*>(data), size, true));
+    if(!snapshot->validate(errMsg, verifyChecksum))
+        return nullptr;
+    return snapshot;
+}
+
+std::unique_ptr<Snapshot> Snapshot::fromBuffer(const void* data, size_t size, std::string& errMsg,
+                                               bool verifyChecksum) noexcept
+{
+    if(reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0)
+    {
+        errMsg = "SNAPSHOT NOT ALIGNED";
+        return nullptr;
+    }
+    std::unique_ptr<Snapshot> snapshot(new Snapshot(static_cast<const char*>(data), size, false));
+    if(!snapshot->validate(errMsg, verifyChecksum))
+        return nullptr;
+    return snapshot;
+}
+
+//只检查文件头和各区大小，不访问节点内容
+bool Snapshot::validate(std::string& errMsg, bool verifyChecksum)
+{
+    SnapshotHeader header;
+    if(_size < sizeof(header))
+    {
+        errMsg = "NOT A SNAPSHOT";
+        return false;
+    }
+    memcpy(&header, _data, sizeof(header));
+    if(memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    {
+        errMsg = "NOT A SNAPSHOT";
+        return false;
+    }
+    if(header.version != kSnapshotVersion || header.headerSize != sizeof(header))
+    {
+        errMsg = "SNAPSHOT VERSION MISMATCH";
+        return false;
+    }
+    if(header.endianTag != kEndianTag)
+    {
+        errMsg = "SNAPSHOT ENDIAN MISMATCH";
+        return false;
+    }
+    size_t body = _size - sizeof(header);
+    if(header.nodeCount == 0 || header.nodeCount > body / sizeof(SnapshotNode)
+        || header.wordCount > (body - header.nodeCount * sizeof(SnapshotNode)) / sizeof(uint64_t)
+        || header.stringBytes != body - header.nodeCount * sizeof(SnapshotNode) - header.wordCount * sizeof(uint64_t))
+    {
+        errMsg = "CORRUPT SNAPSHOT";
+        return false;
+    }
+    if(verifyChecksum && checksum(_data + sizeof(header), body) != header.checksum)
+    {
+        errMsg = "CHECKSUM MISMATCH";
+        return false;
+    }
+    _nodes = reinterpret_cast<const SnapshotNode*>(_data + sizeof(header));
+    _words = reinterpret_cast<const uint64_t*>(_nodes + header.nodeCount);
+    _strings = reinterpret_cast<const char*>(_words + header.wordCount);
+    _nodeCount = header.nodeCount;
+    _wordCount = header.wordCount;
+    _stringBytes = header.stringBytes;
+    return true;
+}
+
+const SnapshotNode& SnapshotValue::node() const
+{
+    if(_index >= _snapshot->_nodeCount)
+        corrupt();
+    return _snapshot->_nodes[_index];
+}
+
+//容器的子节点表，同时检查是否越界
+const uint64_t* SnapshotValue::children() const
+{
+    const SnapshotNode& n = node();
+    uint64_t width = n.type == static_cast<uint32_t>(JsonType::kObject) ? 3 : 1;
+    if(n.b > _snapshot->_wordCount || n.a > (_snapshot->_wordCount - n.b) / width)
+        corrupt();
+    return _snapshot->_words + n.b;
+}
+
+std::string_view SnapshotValue::text(uint64_t offset, uint64_t length) const
+{
+    if(offset > _snapshot->_stringBytes || length > _snapshot->_stringBytes - offset)
+        corrupt();
+    return std::string_view(_snapshot->_strings + offset, length);
+}
+
+JsonType SnapshotValue::getType() const noexcept
+{
+    if(_index >= _snapshot->_nodeCount || _snapshot->_nodes[_index].type > static_cast<uint32_t>(JsonType::kObject))
+        return JsonType::kNull;
+    return static_cast<JsonType>(_snapshot->_nodes[_index].type);
+}
+
+bool SnapshotValue::toBool() const
+{
+    if(!isBool())
+        throw JsonException("not a bool");
+    return node().a != 0;
+}
+
+double SnapshotValue::toNumber() const
+{
+    if(!isNumber())
+        throw JsonException("not a number");
+    double val;
+    memcpy(&val, &node().a, sizeof(val));
+    return val;
+}
+
+std::string_view SnapshotValue::toString() const
+{
+    if(!isString())
+        throw JsonException("not a string");
+    return text(node().a, node().b);
+}
+
+size_t SnapshotValue::size() const
+{
+    if(!isArray() && !isObject())
+        throw JsonException("not a array or object");
+    return node().a;
+}
+
+SnapshotValue SnapshotValue::operator[](size_t pos) const
+{
+    if(!isArray())
+        throw JsonException("not a array");
+    if(pos >= size())
+        throw JsonException("index out of range");
+    return SnapshotValue(_snapshot, children()[pos]);
+}
+
+bool SnapshotValue::find(std::string_view key, uint64_t& index) const
+{
+    if(!isObject())
+        throw JsonException("not a object");
+    const uint64_t* members = children();
+    size_t lo = 0, hi = size();
+    while(lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = text(members[3 * mid], members[3 * mid + 1]).compare(key);
+        if(cmp == 0)
+        {
+            index = members[3 * mid + 2];
+            return true;
+        }
+        if(cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return false;
+}
+
+SnapshotValue SnapshotValue::operator[](std::string_view key) const
+{
+    uint64_t index;
+    if(!find(key, index))
+        throw JsonException("key not found");
+    return SnapshotValue(_snapshot, index);
+}
+
+bool SnapshotValue::contains(std::string_view key) const
+{
+    uint64_t index;
+    return find(key, index);
+}
+
+std::string_view SnapshotValue::key(size_t pos) const
+{
+    if(!isObject())
+        throw JsonException("not a object");
+    if(pos >= size())
+        throw JsonException("index out of range");
+    const uint64_t* members = children();
+    return text(members[3 * pos], members[3 * pos + 1]);
+}
+
+SnapshotValue SnapshotValue::value(size_t pos) const
+{
+    if(!isObject())
+        throw JsonException("not a object");
+    if(pos >= size())
+        throw JsonException("index out of range");
+    return SnapshotValue(_snapshot, children()[3 * pos + 2]);
+}
+
+//用显式栈逐层构造，容器的所有子节点交付后出栈
+//build()写出的子节点下标总是大于父节点，每个节点只属于一个容器
+//不满足时是损坏的快照，这样环和重复引用的子树不会让转换不停地进行下去
+Json SnapshotValue::toJson() const
+{
+    struct Frame
+    {
+        SnapshotValue value;
+        size_t pos;
+        Json::_array arr;
+        Json::_object obj;
+    };
+    std::vector<Frame> stack;
+    SnapshotValue next = *this;
+    Json value;
+    uint64_t visited = 0;
+    while(1)
+    {
+        if(++visited > _snapshot->_nodeCount)
+            corrupt();
+        bool pushed = false;
+        switch(next.getType())
+        {
+            case JsonType::kNull: value = Json(nullptr); break;
+            case JsonType::kBool: value = Json(next.toBool()); break;
+            case JsonType::kNumber:
+                //有原文的数字还原成和rawNumbers解析结果相同的节点
+                if(uint32_t length = next.node().c)
+                    value = Json(std::make_shared<JsonValue>(RawNumber{std::string(next.text(next.node().b, length))}));
+                else
+                    value = Json(next.toNumber());
+                break;
+            case JsonType::kString: value = Json(std::string(next.toString())); break;
+            default:
+                //先检查子节点表的范围，再按元素个数预留空间
+                next.children();
+                stack.push_back({next, 0, {}, {}});
+                if(next.isArray())
+                    stack.back().arr.reserve(next.size());
+                else
+                    stack.back().obj.reserve(next.size());
+                pushed = true;
+                break;
+        }
+        while(1)
+        {
+            if(!pushed)
+            {
+                if(stack.empty())
+                    return value;
+                Frame& top = stack.back();
+                if(top.value.isArray())
+                    top.arr.push_back(std::move(value));
+                else
+                    top.obj.emplace(std::string(top.value.key(top.pos - 1)), std::move(value));
+            }
+            pushed = false;
+            Frame& top = stack.back();
+            if(top.pos < top.value.size())
+            {
+                next = top.value.isArray() ? top.value[top.pos] : top.value.value(top.pos);
+                if(next._index <= top.value._index)
+                    corrupt();
+                top.pos++;
+                break;
+            }
+            value = top.value.isArray() ? Json(std::move(top.arr)) : Json(std::move(top.obj));
+            stack.pop_back();
+        }
+    }
+}
+}//namespace LeptJson
@@ -0,0 +1,58 @@
+#include<vector>
+#include"staticJson.h"
+
+namespace LeptJson
+{
+//节点是先序排列的，顺序扫描一遍，用显式栈记录还没填满的容器
+Json JsonView::toJson() const
+{
+    struct Frame
+    {
+        bool isObject;
+        size_t remaining;
+        std::string key;
+        Json::_array arr;
+        Json::_object obj;
+    };
+    std::vector<Frame> stack;
+    size_t end = node().next;
+    for(size_t i = _index; i < end; i++)
+    {
+        const StaticNode& curr = _nodes[i];
+        std::string key(_chars + curr.keyBegin, curr.keyLength);
+        Json value;
+        switch(curr.type)
+        {
+            case JsonType::kNull: break;
+            case JsonType::kBool: value = Json(curr.boolean); break;
+            case JsonType::kNumber: value = Json(curr.number); break;
+            case JsonType::kString: value = Json(std::string(_chars + curr.begin, curr.length)); break;
+            default:
+                if(curr.length > 0)
+                {
+                    stack.push_back({curr.type == JsonType::kObject, curr.length, std::move(key), {}, {}});
+                    continue;
+                }
+                value = curr.type == JsonType::kObject ? Json(Json::_object()) : Json(Json::_array());
+                break;
+        }
+        //把值交给栈顶容器，填满的容器出栈后继续向上交付
+        while(!stack.empty())
+        {
+            Frame& top = stack.back();
+            if(top.isObject)
+                top.obj.emplace(std::move(key), std::move(value));
+            else
+                top.arr.push_back(std::move(value));
+            if(--top.remaining > 0)
+                break;
+            value = top.isObject ? Json(std::move(top.obj)) : Json(std::move(top.arr));
+            key = std::move(top.key);
+            stack.pop_back();
+        }
+        if(stack.empty())
+            return value;
+    }
+    return Json(nullptr);
+}
+}//namespace LeptJson
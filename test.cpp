@@ -1,6 +1,26 @@
+#include <cstdio>
+#include <cstring>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include "gtest/gtest.h"
+#include "countingResource.h"
 #include "json.h"
+#include "jsonBind.h"
+#include "jsonColumns.h"
+#include "jsonException.h"
+#include "jsonPatch.h"
+#include "jsonPath.h"
+#include "jsonReader.h"
+#include "jsonSchema.h"
+#include "jsonWriter.h"
+#include "parseCache.h"
+#include "snapshot.h"
+#include "staticJson.h"
+#ifdef LEPTJSON_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace LeptJson;
 using namespace std;
@@ -246,6 +266,93 @@ TEST(RoundTrip, JsonArray) {
     testRoundtrip("[ null , false , true , 123 , \"abc\" , [ 1 , 2 , 3 ] ]");
 }
 
+TEST(Serialize, Escape) {
+    SerializeOptions options;
+    EXPECT_EQ(Json("a\x01\x1F/\xE4\xB8\xAD").serialize(), "\"a\\u0001\\u001F/\xE4\xB8\xAD\"");
+    options.escapeSlash = true;
+    EXPECT_EQ(Json("</script>").serialize(options), "\"<\\/script>\"");
+    options.escapeUnicode = true;
+    EXPECT_EQ(Json("\xE4\xB8\xAD\xF0\x9D\x84\x9E").serialize(options), "\"\\u4E2D\\uD834\\uDD1E\"");
+    EXPECT_EQ(Json("a\xFF\xC3").serialize(options), "\"a\\uFFFD\\uFFFD\"");
+
+    //跨越16字节块的长串
+    string raw(100, 'x');
+    raw[15] = '"';
+    raw[16] = '\n';
+    raw[70] = '\\';
+    string expect = "\"" + raw.substr(0, 15) + "\\\"\\n" + raw.substr(17, 53) + "\\\\" + raw.substr(71) + "\"";
+    EXPECT_EQ(Json(raw).serialize(), expect);
+}
+
+TEST(Serialize, Writer) {
+    string errMsg;
+    string content = "[";
+    for (int i = 0; i < 1000; i++) content += (i ? ",{\"k\":\"v" : "{\"k\":\"v") + std::to_string(i) + "\"}";
+    content += "]";
+    Json json = Json::parse(content, errMsg);
+    string expect = json.serialize();
+
+    string out;
+    size_t maxChunk = 0;
+    {
+        CallbackWriter writer([&](const char* data, size_t len) {
+            out.append(data, len);
+            maxChunk = std::max(maxChunk, len);
+            return true;
+        }, 256);
+        EXPECT_TRUE(writer.write(json));
+    }
+    EXPECT_EQ(out, expect);
+    EXPECT_LT(maxChunk, 256u + 64u);
+
+    //writev批量写出
+    FILE* file = tmpfile();
+    {
+        FdWriter writer(fileno(file), 128, 4);
+        writer.write(json);
+        writer.write("\n", 1);
+        EXPECT_TRUE(writer.flush());
+    }
+    rewind(file);
+    string read(expect.size() + 1, '\0');
+    EXPECT_EQ(fread(&read[0], 1, read.size(), file), read.size());
+    EXPECT_EQ(read, expect + "\n");
+    fclose(file);
+
+    std::ostringstream os;
+    os << json;
+    EXPECT_EQ(os.str(), expect);
+
+    CallbackWriter failing([](const char*, size_t) { return false; }, 16);
+    EXPECT_FALSE(failing.write(json));
+    EXPECT_FALSE(failing.good());
+
+    //紧凑数组和拼接的缓存片段也按缓冲区大小分块写出
+    ParseOptions packOptions;
+    packOptions.packNumbers = true;
+    string numbers = "[";
+    for (int i = 0; i < 2000; i++) numbers += (i ? "," : "") + std::to_string(i * 7);
+    numbers += "]";
+    Json packed = Json::parse(R"({ "nums" : )" + numbers + R"(, "rows" : )" + content + " }", errMsg, packOptions);
+    ASSERT_EQ(errMsg, "");
+    SerializeOptions cached;
+    cached.cacheFragments = true;
+    string packedExpect = packed.serialize(cached);
+    EXPECT_GT(packed.memoryUsage().fragmentBytes, 0u);
+    out.clear();
+    maxChunk = 0;
+    {
+        CallbackWriter writer([&](const char* data, size_t len) {
+            out.append(data, len);
+            maxChunk = std::max(maxChunk, len);
+            return true;
+        }, 256);
+        EXPECT_TRUE(writer.write(packed, cached));
+    }
+    EXPECT_EQ(out, packedExpect);
+    EXPECT_LT(maxChunk, 256u + 64u);
+}
+
 // TODO::
 // Temporarily failed to pass RoundTrip test
 // Because MiniJson store a Json Object as a hashmap
@@ -257,6 +364,60 @@ TEST(RoundTrip, JsonArray) {
 //         R"({ "n": null, "f": false, "t": true, "i": 123, "a": [ 1, 2, 3 ], "s": "abc", "o": { "1": 1, "2": 2, "3": 3 } })"));
 // }
 
+TEST(Serialize, CachedFragments) {
+    Json doc = Json::_object{{"version", 1}, {"catalog", Json::_array{}}};
+    for (int i = 0; i < 20; i++)
+        doc["catalog"].push_back(Json::_object{{"id", i}, {"name", "item/" + to_string(i)}, {"tags", Json::_array{"red", "green", "blue"}}});
+    SerializeOptions cached;
+    cached.cacheFragments = true;
+    string first = doc.serialize(cached);
+    EXPECT_EQ(first, doc.serialize());
+    size_t fragments = doc.memoryUsage().fragmentBytes;
+    EXPECT_GT(fragments, first.size());
+    EXPECT_EQ(doc.serialize(cached), first);
+
+    //修改只清除路径上的缓存
+    doc["catalog"][3]["name"] = "changed";
+    EXPECT_GT(doc.memoryUsage().fragmentBytes, 0u);
+    EXPECT_LT(doc.memoryUsage().fragmentBytes, fragments);
+    EXPECT_EQ(doc.serialize(cached), doc.serialize());
+    EXPECT_NE(doc.serialize(cached), first);
+
+    //共享节点的拷贝修改后互不影响
+    Json copy = doc;
+    copy["catalog"].erase(0);
+    EXPECT_EQ(copy.serialize(cached), copy.serialize());
+    EXPECT_EQ(doc.serialize(cached), doc.serialize());
+
+    //转义选项不同时不使用缓存
+    SerializeOptions slash = cached;
+    slash.escapeSlash = true;
+    EXPECT_NE(doc.serialize(slash).find("item\\/"), string::npos);
+
+    //保留子节点的引用在序列化之后修改
+    Json z = parseOk(R"({ "items" : [ "alpha-alpha-alpha" , "beta-beta-beta" , "gamma-gamma-gamma" ] , "n" : 1 })");
+    Json& items = z["items"];
+    z.serialize(cached);
+    items.push_back("new");
+    EXPECT_EQ(z.serialize(cached), z.serialize());
+    EXPECT_NE(z.serialize(cached).find("\"new\""), string::npos);
+
+    //多个线程同时生成缓存
+    Json fresh = parseOk(first);
+    string expect = fresh.serialize();
+    vector<thread> threads;
+    vector<string> results(4);
+    for (size_t i = 0; i < results.size(); i++)
+        threads.emplace_back([&, i] {
+            for (int n = 0; n < 50; n++)
+                results[i] = fresh.serialize(cached);
+        });
+    for (auto& t : threads)
+        t.join();
+    for (auto& r : results)
+        EXPECT_EQ(r, expect);
+}
+
 TEST(Error, ExpectValue) {
     testError("EXPECT VALUE", "");
     testError("EXPECT VALUE", " ");
@@ -351,6 +512,12 @@ TEST(Error, MissColon) {
     testError("MISS COLON", "{\"a\",\"b\"}");
 }
 
+TEST(Error, NestingTooDeep) {
+    testError("NESTING TOO DEEP", string(kDefaultMaxDepth + 1, '['));
+    testError("NESTING TOO DEEP", "{\"a\":" + string(kDefaultMaxDepth, '['));
+    testError("EXPECT VALUE", string(kDefaultMaxDepth, '['));
+}
+
 TEST(Error, MissCommaOrCurlyBracket) {
     testError("MISS COMMA OR CURLY BRACKET", "{\"a\":1");
     testError("MISS COMMA OR CURLY BRACKET", "{\"a\":1]");
@@ -358,6 +525,242 @@ TEST(Error, MissCommaOrCurlyBracket) {
     testError("MISS COMMA OR CURLY BRACKET", "{\"a\":{}");
 }
 
+TEST(Projection, Fields) {
+    ParseOptions options;
+    options.fields = {"id", "user.name", "items.price", "meta"};
+    string content = R"({
+        "id" : 1,
+        "blob" : { "a" : [1, "]}\"", {"b" : null}], "c" : "{[" },
+        "user" : { "name" : "lept", "bio" : "x\\" },
+        "items" : [ { "price" : 2, "desc" : [true] }, { "desc" : false } ],
+        "meta" : { "k" : [1, 2] },
+        "tail" : -1.5e3
+    })";
+    string errMsg;
+    Json json = Json::parse(content, errMsg, options);
+    EXPECT_EQ(errMsg, "");
+    EXPECT_EQ(json.size(), 4);
+    EXPECT_EQ(json["id"].toNumber(), 1);
+    EXPECT_EQ(json["user"].size(), 1);
+    EXPECT_EQ(json["user"]["name"].toString(), "lept");
+    EXPECT_EQ(json["items"].size(), 2);
+    EXPECT_EQ(json["items"][0].size(), 1);
+    EXPECT_EQ(json["items"][0]["price"].toNumber(), 2);
+    EXPECT_EQ(json["items"][1].size(), 0);
+    EXPECT_EQ(json["meta"], parseOk(R"({ "k" : [1, 2] })"));
+
+    Json all = Json::parse(content, errMsg, ParseOptions());
+    EXPECT_EQ(all, parseOk(content));
+
+    errMsg.clear();
+    Json::parse(R"({ "skip" : [1, {"a" : 2} )", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS CLOSING BRACKET");
+    Json::parse(R"({ "skip" : "abc )", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS QUOTATION MARK");
+}
+
+TEST(Parse, Stats) {
+    ParseStats stats;
+    ParseOptions options;
+    options.stats = &stats;
+    string errMsg;
+    Json json = Json::parse(R"( { "a" : [1, 2.5, null, true], "b" : { "c" : "xy" } } )", errMsg, options);
+    EXPECT_EQ(errMsg, "");
+#ifdef LEPTJSON_PARSE_STATS
+    EXPECT_EQ(stats.numbers, 2);
+    EXPECT_EQ(stats.nulls, 1);
+    EXPECT_EQ(stats.bools, 1);
+    EXPECT_EQ(stats.strings, 1);
+    EXPECT_EQ(stats.keys, 3);
+    EXPECT_EQ(stats.arrays, 1);
+    EXPECT_EQ(stats.objects, 2);
+    EXPECT_EQ(stats.maxDepth, 2);
+    EXPECT_EQ(stats.numberBytes, 4);
+    EXPECT_EQ(stats.literalBytes, 8);
+    EXPECT_EQ(stats.stringBytes, 13);
+    EXPECT_GT(stats.totalCycles, 0);
+#else
+    EXPECT_EQ(stats.numbers, 0);
+    EXPECT_EQ(stats.totalCycles, 0);
+#endif
+}
+
+TEST(Parse, PackNumbers) {
+    string errMsg;
+    ParseOptions options;
+    options.packNumbers = true;
+    string content = R"({ "ints" : [ 1 , -2 , 3 ] , "reals" : [ [ 0.5 , -0 ] , [ 1e300 , 2 ] ] , "mixed" : [ 1 , "a" , 2 ] , "empty" : [ ] })";
+    Json plain = parseOk(content);
+    Json packed = Json::parse(content, errMsg, options);
+    EXPECT_EQ(errMsg, "");
+
+    const Json& ints = packed["ints"];
+    EXPECT_TRUE(ints.isPacked());
+    EXPECT_TRUE(ints.isArray());
+    ASSERT_EQ(ints.packedInts().size, 3u);
+    EXPECT_EQ(ints.packedInts()[1], -2);
+    EXPECT_TRUE(ints.packedDoubles().empty());
+    EXPECT_EQ(packed["reals"][0].packedDoubles()[0], 0.5);
+    EXPECT_TRUE(packed["reals"][0].packedInts().empty());
+    EXPECT_FALSE(packed["mixed"].isPacked());
+    EXPECT_FALSE(packed["empty"].isPacked());
+
+    EXPECT_EQ(packed.serialize(), plain.serialize());
+    EXPECT_EQ(packed.canonicalize(), plain.canonicalize());
+    EXPECT_EQ(packed, plain);
+    EXPECT_EQ(packed.hash(), plain.hash());
+    EXPECT_EQ(ints[2].toNumber(), 3);
+    EXPECT_EQ(ints.toArray().size(), 3u);
+
+    //修改时展开，共享的拷贝保持紧凑
+    Json copy = packed;
+    copy["ints"].push_back(Json(4));
+    EXPECT_FALSE(copy["ints"].isPacked());
+    EXPECT_TRUE(packed["ints"].isPacked());
+    EXPECT_EQ(copy["ints"], parseOk("[ 1 , -2 , 3 , 4 ]"));
+
+    string numbers = "[";
+    for (int i = 0; i < 1000; i++) numbers += (i ? "," : "") + std::to_string(i * 0.25);
+    numbers += "]";
+    Json big = Json::parse(numbers, errMsg, options);
+    EXPECT_LT(big.memoryUsage().totalBytes() * 4, parseOk(numbers).memoryUsage().totalBytes());
+
+    errMsg.clear();
+    Json::parse("[1 2]", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, 28), "MISS COMMA OR SQUARE BRACKET");
+    Json::parse("[1, -]", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, 13), "INVALID VALUE");
+}
+
+TEST(Parse, DeepNesting) {
+    const size_t depth = 200000;
+    string content = string(depth, '[') + "{\"k\":null}" + string(depth, ']');
+    ParseOptions options;
+    options.maxDepth = depth + 1;
+    string errMsg;
+    Json json = Json::parse(content, errMsg, options);
+    EXPECT_EQ(errMsg, "");
+    Json copy = Json::parse(content, errMsg, options);
+    EXPECT_EQ(json, copy);
+    copy[0] = Json(1);
+    EXPECT_NE(json, copy);
+
+    string expect;
+    for (size_t i = 0; i < depth; i++) expect += "[ ";
+    expect += "{ \"k\" : null }";
+    for (size_t i = 0; i < depth; i++) expect += " ]";
+    EXPECT_EQ(json.serialize(), expect);
+}
+
+#define testUtf8(valid, raw)                                          \
+    do {                                                              \
+        ParseOptions options;                                         \
+        options.strictUtf8 = true;                                    \
+        string errMsg;                                                \
+        Json json = Json::parse(string("\"") + raw + "\"", errMsg, options); \
+        if (valid)                                                    \
+            EXPECT_EQ(errMsg, "");                                    \
+        else                                                          \
+            EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "INVALID UTF8"); \
+    } while (0)
+
+TEST(Parse, StrictUtf8) {
+    testUtf8(true, "plain ascii text that is longer than sixteen bytes");
+    testUtf8(true, "\xC2\xA2 \xE2\x82\xAC \xF0\x9D\x84\x9E \xEF\xBF\xBF \xF4\x8F\xBF\xBF");
+    testUtf8(true, "0123456789abcdef0123456789\xE4\xB8\xAD\xE6\x96\x87");
+    testUtf8(false, "\x80");
+    testUtf8(false, "\xC0\x80");
+    testUtf8(false, "\xC1\xBF");
+    testUtf8(false, "\xE0\x80\xAF");
+    testUtf8(false, "\xED\xA0\x80");
+    testUtf8(false, "\xF0\x80\x80\xAF");
+    testUtf8(false, "\xF4\x90\x80\x80");
+    testUtf8(false, "\xF5\x80\x80\x80");
+    testUtf8(false, "\xFF");
+    testUtf8(false, "\xE2\x82");
+    testUtf8(false, "0123456789abcdef0123456789\xE2\x82");
+    testUtf8(false, "\xE2\x82\\n");
+
+    ParseOptions options;
+    options.strictUtf8 = true;
+    string errMsg;
+    Json::parse("{\"\xC0\x80\" : 1}", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "INVALID UTF8");
+    Json::parse("\"\\uDC00\"", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "INVALID UNICODE SURROGATE");
+
+    //默认不校验，原样保留
+    testString("\xC0\x80", "\"\xC0\x80\"");
+}
+
+TEST(Parse, RawNumbers) {
+    string text = R"({"big" : 12345678901234567890123, "id" : 9007199254740993, "price" : 0.10, "exp" : -1E+2, "arr" : [1, 2.50, 3]})";
+    ParseOptions options;
+    options.rawNumbers = true;
+    options.packNumbers = true;
+    string errMsg;
+    Json json = Json::parse(text, errMsg, options);
+    EXPECT_EQ(errMsg, "");
+
+    //原文原样输出，取值时才转换
+    Json expect = parseOk(text);
+    EXPECT_EQ(json, expect);
+    EXPECT_EQ(json.hash(), expect.hash());
+    EXPECT_FALSE(json["arr"].isPacked());
+    EXPECT_EQ(*json["price"].rawNumber(), "0.10");
+    EXPECT_EQ(expect["price"].rawNumber(), nullptr);
+    EXPECT_EQ(parseOk(json.serialize()), expect);
+    EXPECT_NE(json.serialize().find("12345678901234567890123"), string::npos);
+    EXPECT_NE(json.serialize().find("[ 1 , 2.50 , 3 ]"), string::npos);
+    EXPECT_EQ(json["exp"].toNumber(), -100);
+
+    //整数不经过double
+    EXPECT_EQ(json["id"].toInt64(), 9007199254740993);
+    EXPECT_EQ(json["exp"].toInt64(), -100);
+    EXPECT_EQ(expect["id"].toInt64(), 9007199254740992);
+    EXPECT_THROW(json["price"].toInt64(), JsonException);
+    EXPECT_THROW(json["big"].toInt64(), JsonException);
+
+    Json::parse("[1, 01]", errMsg, options);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS COMMA OR SQUARE BRACKET");
+}
+
+TEST(Parse, Into) {
+    string first = R"({"name" : ")" + string(100, 'a') + R"(", "items" : [{"id" : 1, "tags" : [5, 6]}, {"id" : 2}], "ok" : true})";
+    string second = R"({"name" : ")" + string(80, 'b') + R"(", "items" : [{"id" : 3, "tags" : [7]}, {"id" : 4, "extra" : null}], "ok" : false, "id" : 1})";
+    string errMsg;
+    Json doc;
+    EXPECT_TRUE(Json::parseInto(doc, first, errMsg));
+    EXPECT_EQ(doc, parseOk(first));
+
+    //形状相近的第二次解析重用原来的数组缓冲区和字符串容量
+    const Json& view = doc;
+    const Json* item = &view["items"][0];
+    const char* name = view["name"].toString().data();
+    EXPECT_TRUE(Json::parseInto(doc, second, errMsg));
+    EXPECT_EQ(doc, parseOk(second));
+    EXPECT_EQ(&view["items"][0], item);
+    EXPECT_EQ(view["name"].toString().data(), name);
+
+    //共享出去的子树不会被改写
+    Json keep = doc["items"];
+    EXPECT_TRUE(Json::parseInto(doc, first, errMsg));
+    EXPECT_EQ(doc, parseOk(first));
+    EXPECT_EQ(keep, parseOk(second)["items"]);
+
+    //用非const的[]访问过的文档重用后，拷贝仍然共享节点
+    doc["items"][0]["id"];
+    EXPECT_TRUE(Json::parseInto(doc, second, errMsg));
+    Json copy = doc;
+    EXPECT_TRUE(copy.shares(doc));
+    EXPECT_TRUE(copy.toObject().at("items").shares(doc.toObject().at("items")));
+
+    //失败时target为null
+    EXPECT_FALSE(Json::parseInto(doc, "[1, 2", errMsg));
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS COMMA OR SQUARE BRACKET");
+    EXPECT_TRUE(doc.isNull());
+}
+
 TEST(Json, Ctor) {
     {
         Json json;
@@ -420,6 +823,865 @@ TEST(Json, Ctor) {
     }
 }
 
+TEST(Json, CopyOnWrite) {
+    Json origin = Json::_object{
+        {"name", "config"},
+        {"list", Json::_array{1, 2, 3}},
+        {"nested", Json::_object{{"a", 1}, {"b", 2}}},
+    };
+    Json copy = origin;
+    EXPECT_EQ(copy, origin);
+
+    copy["nested"]["a"] = Json(100);
+    EXPECT_EQ(copy["nested"]["a"].toNumber(), 100);
+    EXPECT_EQ(origin.at("nested").at("a").toNumber(), 1);
+
+    copy["list"][0] = Json("changed");
+    EXPECT_TRUE(copy["list"][0].isString());
+    EXPECT_TRUE(origin.at("list").at(0).isNumber());
+
+    origin["name"] = Json("other");
+    EXPECT_EQ(copy["name"].toString(), "config");
+    EXPECT_EQ(origin["name"].toString(), "other");
+}
+
+TEST(Json, RetainedReference) {
+    //at()只读，拷贝仍然共享；非const的[]即使只是读取，节点也不再共享
+    Json cfg = parseOk(R"({"a" : 1, "list" : [1, 2]})");
+    EXPECT_EQ(cfg.at("a").toNumber(), 1);
+    EXPECT_EQ(cfg.at("list").at(1).toNumber(), 2);
+    Json shared = cfg;
+    EXPECT_TRUE(shared.shares(cfg));
+    EXPECT_EQ(cfg["a"].toNumber(), 1);
+    Json copied = cfg;
+    EXPECT_FALSE(copied.shares(cfg));
+    EXPECT_TRUE(copied.at("list").shares(cfg.at("list")));
+
+    Json doc = parseOk(R"({"a" : {"k" : 1}, "arr" : [1, 2]})");
+    Json& a = doc["a"];
+    Json& e = doc["arr"];
+    Json snap = doc;
+    a["k"] = 2;
+    e.push_back(3);
+    EXPECT_EQ(snap, parseOk(R"({"a" : {"k" : 1}, "arr" : [1, 2]})"));
+    EXPECT_EQ(doc, parseOk(R"({"a" : {"k" : 2}, "arr" : [1, 2, 3]})"));
+
+    //引用所在的节点被移进别的容器后，拷贝这个容器也要复制
+    Json inner = Json::_object{};
+    Json& slot = inner["x"];
+    Json outer = Json::_array{};
+    outer.push_back(std::move(inner));
+    Json copy = outer;
+    slot = 5;
+    EXPECT_TRUE(copy[0]["x"].isNull());
+    EXPECT_EQ(outer[0]["x"].toNumber(), 5);
+
+    Json member = Json::_object{};
+    Json& field = member["y"];
+    Json::_array items;
+    items.push_back(std::move(member));
+    Json built(std::move(items));
+    Json builtCopy = built;
+    field = 6;
+    EXPECT_TRUE(builtCopy[0]["y"].isNull());
+    EXPECT_EQ(built[0]["y"].toNumber(), 6);
+}
+
+struct Point {
+    double x = 0;
+    double y = 0;
+};
+LEPTJSON_BIND(Point, LEPTJSON_FIELD(x), LEPTJSON_FIELD(y));
+
+struct Shape {
+    string name;
+    int id = 0;
+    bool visible = false;
+    vector<Point> points;
+    Json extra;
+};
+LEPTJSON_BIND(Shape, LEPTJSON_FIELD(name), LEPTJSON_FIELD_AS(id, "shape_id"),
+              LEPTJSON_FIELD(visible), LEPTJSON_FIELD(points), LEPTJSON_FIELD(extra));
+
+struct Counter {
+    uint8_t small = 0;
+    vector<int64_t> big;
+    int quoted = 0;
+};
+LEPTJSON_BIND(Counter, LEPTJSON_FIELD(small), LEPTJSON_FIELD(big), LEPTJSON_FIELD_AS(quoted, "say \"hi\""));
+
+struct Flags {
+    vector<bool> bits;
+    char grade = 'a';
+    signed char delta = 0;
+    double ratio = 0;
+};
+LEPTJSON_BIND(Flags, LEPTJSON_FIELD(bits), LEPTJSON_FIELD(grade), LEPTJSON_FIELD(delta), LEPTJSON_FIELD(ratio));
+
+TEST(Json, Mutators) {
+    Json doc = parseOk(R"({ "items" : [ 1 , 2 ] , "name" : "a" })");
+    Json copy = doc;
+
+    Json& items = doc["items"];
+    items.reserve(8);
+    items.push_back(Json(3));
+    items.emplace_back("four");
+    items.insert(0, Json(0));
+    items.erase(1);
+    EXPECT_EQ(items, parseOk(R"([ 0 , 2 , 3 , "four" ])"));
+    EXPECT_THROW(items.insert(10, Json(nullptr)), std::out_of_range);
+    EXPECT_THROW(items.set("k", Json(1)), JsonException);
+
+    doc["added"] = Json(true);
+    EXPECT_TRUE(doc.insert("other", Json(1)));
+    EXPECT_FALSE(doc.insert("other", Json(2)));
+    EXPECT_EQ(doc.set("other", Json(3)).toNumber(), 3);
+    EXPECT_EQ(doc.erase("name"), 1u);
+    EXPECT_EQ(doc.erase("name"), 0u);
+    EXPECT_EQ(doc, parseOk(R"({ "items" : [ 0 , 2 , 3 , "four" ] , "added" : true , "other" : 3 })"));
+
+    //共享的拷贝不受影响
+    EXPECT_EQ(copy, parseOk(R"({ "items" : [ 1 , 2 ] , "name" : "a" })"));
+    copy.clear();
+    EXPECT_EQ(copy.size(), 0u);
+    EXPECT_EQ(doc.size(), 3u);
+}
+
+TEST(Patch, MergePatch) {
+    // RFC 7386附录A的例子
+    Json target = parseOk(R"({ "title" : "Goodbye!" , "author" : { "givenName" : "John" , "familyName" : "Doe" } , "tags" : [ "example" , "sample" ] , "content" : "This will be unchanged" })");
+    Json patch = parseOk(R"({ "title" : "Hello!" , "phoneNumber" : "+01-123-456-7890" , "author" : { "familyName" : null } , "tags" : [ "example" ] })");
+    mergePatch(target, patch);
+    EXPECT_EQ(target, parseOk(R"({ "title" : "Hello!" , "author" : { "givenName" : "John" } , "tags" : [ "example" ] , "content" : "This will be unchanged" , "phoneNumber" : "+01-123-456-7890" })"));
+
+    Json scalar = Json(1);
+    mergePatch(scalar, parseOk(R"({ "a" : { "b" : null , "c" : 2 } })"));
+    EXPECT_EQ(scalar, parseOk(R"({ "a" : { "c" : 2 } })"));
+}
+
+TEST(Patch, JsonPatch) {
+    string errMsg;
+    Json doc = parseOk(R"({ "foo" : [ "bar" , "baz" ] , "a/b" : { "c" : 1 } , "m~n" : 2 })");
+    Json shared = doc;
+    Json patch = parseOk(R"([
+        { "op" : "add" , "path" : "/foo/1" , "value" : "qux" },
+        { "op" : "add" , "path" : "/foo/-" , "value" : "end" },
+        { "op" : "remove" , "path" : "/foo/0" },
+        { "op" : "replace" , "path" : "/m~0n" , "value" : 3 },
+        { "op" : "move" , "from" : "/a~1b/c" , "path" : "/moved" },
+        { "op" : "copy" , "from" : "/foo" , "path" : "/copy" },
+        { "op" : "test" , "path" : "/copy/0" , "value" : "qux" }
+    ])");
+    EXPECT_TRUE(applyPatch(doc, patch, errMsg));
+    EXPECT_EQ(errMsg, "");
+    EXPECT_EQ(doc, parseOk(R"({ "foo" : [ "qux" , "baz" , "end" ] , "a/b" : {} , "m~n" : 3 , "moved" : 1 , "copy" : [ "qux" , "baz" , "end" ] })"));
+    EXPECT_EQ(shared, parseOk(R"({ "foo" : [ "bar" , "baz" ] , "a/b" : { "c" : 1 } , "m~n" : 2 })"));
+    EXPECT_EQ(*resolvePointer(doc, "/foo/2"), Json("end"));
+    EXPECT_EQ(resolvePointer(doc, "/foo/01"), nullptr);
+
+    //失败时整个patch不生效
+    Json before = doc;
+    EXPECT_FALSE(applyPatch(doc, parseOk(R"([ { "op" : "remove" , "path" : "/moved" } , { "op" : "test" , "path" : "/moved" , "value" : 1 } ])"), errMsg));
+    EXPECT_EQ(errMsg, "PATH NOT FOUND: /moved");
+    EXPECT_EQ(doc, before);
+    EXPECT_FALSE(applyPatch(doc, parseOk(R"([ { "op" : "move" , "from" : "/foo" , "path" : "/foo/0" } ])"), errMsg));
+    EXPECT_EQ(errMsg, "CANNOT MOVE INTO CHILD: /foo/0");
+    EXPECT_FALSE(applyPatch(doc, parseOk(R"([ { "op" : "jump" , "path" : "" } ])"), errMsg));
+    EXPECT_EQ(errMsg, "INVALID PATCH: UNKNOWN OP jump");
+
+    //每种操作都在原处修改，失败时倒序撤销
+    Json original = parseOk(R"({ "list" : [ 1 , 2 ] , "obj" : { "k" : "v" , "t" : 0 } , "n" : null })");
+    Json target = original;
+    EXPECT_FALSE(applyPatch(target, parseOk(R"([
+        { "op" : "add" , "path" : "/list/-" , "value" : 3 },
+        { "op" : "add" , "path" : "/list/0" , "value" : 0 },
+        { "op" : "replace" , "path" : "/obj/k" , "value" : "w" },
+        { "op" : "move" , "from" : "/obj/t" , "path" : "/n" },
+        { "op" : "copy" , "from" : "/list" , "path" : "/obj/copy" },
+        { "op" : "remove" , "path" : "/list/1" },
+        { "op" : "add" , "path" : "/obj/k" , "value" : 5 },
+        { "op" : "test" , "path" : "/n" , "value" : 1 }
+    ])"), errMsg));
+    EXPECT_EQ(errMsg, "TEST FAILED: /n");
+    EXPECT_EQ(target, parseOk(R"({ "list" : [ 1 , 2 ] , "obj" : { "k" : "v" , "t" : 0 } , "n" : null })"));
+    EXPECT_EQ(original, target);
+}
+
+TEST(Patch, Diff) {
+    Json from = parseOk(R"({ "same" : [ 1 , 2 , 3 ] , "arr" : [ 1 , 2 , 3 , 4 ] , "obj" : { "x" : 1 , "y" : 2 } , "gone" : true })");
+    Json to = from;
+    to["arr"].erase(1);
+    to["arr"].insert(0, Json(0));
+    to["obj"]["y"] = Json("two");
+    to["obj"]["z"] = Json(nullptr);
+    to.erase("gone");
+    Json patch = diff(from, to);
+    //共享的"same"不出现在patch里
+    EXPECT_EQ(patch.serialize().find("same"), string::npos);
+
+    string errMsg;
+    Json result = from;
+    EXPECT_TRUE(applyPatch(result, patch, errMsg));
+    EXPECT_EQ(result, to);
+    EXPECT_EQ(diff(to, to).size(), 0u);
+    EXPECT_EQ(diff(Json(1), Json("a")), parseOk(R"([ { "op" : "replace" , "path" : "" , "value" : "a" } ])"));
+}
+
+TEST(Json, Hash) {
+    Json a = parseOk(R"({ "x" : [ 1 , 2 , { "y" : null } ] , "z" : "s" , "w" : -0 })");
+    Json b = parseOk(R"({ "w" : 0 , "z" : "s" , "x" : [ 1 , 2 , { "y" : null } ] })");
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.hash(), b.hash());
+    EXPECT_NE(parseOk("[ 1 , 2 ]").hash(), parseOk("[ 2 , 1 ]").hash());
+    EXPECT_NE(parseOk("[ ]").hash(), parseOk("{ }").hash());
+    EXPECT_NE(Json("").hash(), Json(nullptr).hash());
+
+    //修改后缓存的哈希失效
+    size_t before = b.hash();
+    Json c = b;
+    b["x"][2]["y"] = Json(1);
+    EXPECT_NE(b.hash(), before);
+    EXPECT_EQ(c.hash(), before);
+    EXPECT_NE(b, c);
+    b["x"][2]["y"] = Json(nullptr);
+    EXPECT_EQ(b.hash(), before);
+
+    //通过保留的引用修改后，比较和哈希不能用旧的缓存
+    Json x = parseOk(R"({ "o" : { "y" : "abc" } })");
+    Json y = parseOk(R"({ "o" : { "y" : "def" } })");
+    Json& o = x["o"];
+    x.hash();
+    y.hash();
+    o["y"] = "def";
+    EXPECT_EQ(x, y);
+    EXPECT_EQ(x.hash(), y.hash());
+
+    std::unordered_set<Json> set{a, b, c, parseOk("[ 1 ]")};
+    EXPECT_EQ(set.size(), 2u);
+}
+
+TEST(Json, Canonicalize) {
+    // RFC 8785第3.2.2节和附录B的例子
+    Json numbers = parseOk("[ 333333333.33333329 , 1E30 , 4.50 , 2e-3 , 0.000000000000000000000000001 , -0 , 1e21 , 1e20 , 1e-7 , 0.000001 , -5e-324 ]");
+    EXPECT_EQ(numbers.canonicalize(), "[333333333.3333333,1e+30,4.5,0.002,1e-27,0,1e+21,100000000000000000000,1e-7,0.000001,-5e-324]");
+    Json keys = parseOk(R"({ "\u20ac" : 1 , "\r" : 2 , "\ufb33" : 3 , "1" : 4 , "\ud83d\ude00" : 5 , "\u0080" : 6 , "\u00f6" : 7 })");
+    EXPECT_EQ(keys.canonicalize(), "{\"\\r\":2,\"1\":4,\"\xC2\x80\":6,\"\xC3\xB6\":7,\"\xE2\x82\xAC\":1,\"\xF0\x9F\x98\x80\":5,\"\xEF\xAC\xB3\":3}");
+    EXPECT_EQ(parseOk(R"({ "b" : [ true , null , "\u001f\/" ] , "a" : { } })").canonicalize(), "{\"a\":{},\"b\":[true,null,\"\\u001f/\"]}");
+    EXPECT_THROW(Json(INFINITY).canonicalize(), JsonException);
+    EXPECT_THROW(Json(-INFINITY).canonicalize(), JsonException);
+    EXPECT_THROW(Json(Json::_array{Json(1), Json(NAN)}).canonicalize(), JsonException);
+}
+
+static constexpr auto kLiteral = LEPTJSON_LITERAL(R"({ "name" : "svcé𝄞" , "port" : 8080 , "ratio" : 0.25 , "big" : 1.5e300 , "debug" : false , "tags" : [ "a" , [ ] , { } , null ] , "nested" : { "k" : -1E-3 } })");
+static_assert(kLiteral.root()["port"].toNumber() == 8080);
+static_assert(kLiteral.root()["tags"].size() == 4);
+static_assert(kLiteral.root()["tags"][3].isNull());
+static_assert(kLiteral.root().key(1) == "port");
+static_assert(!kLiteral.root().contains("missing"));
+static_assert(kLiteral.root()["name"].toString() == "svc\xC3\xA9\xF0\x9D\x84\x9E");
+
+TEST(StaticJson, Literal) {
+    constexpr JsonView root = kLiteral.root();
+    EXPECT_EQ(root["ratio"].toNumber(), 0.25);
+    EXPECT_EQ(root["nested"]["k"].toNumber(), -1E-3);
+    EXPECT_EQ(root["big"].toNumber(), 1.5e300);
+    EXPECT_FALSE(root["debug"].toBool());
+
+    Json json = kLiteral.toJson();
+    EXPECT_EQ(json, parseOk(R"({ "name" : "svcé𝄞" , "port" : 8080 , "ratio" : 0.25 , "big" : 1.5e300 , "debug" : false , "tags" : [ "a" , [ ] , { } , null ] , "nested" : { "k" : -1E-3 } })"));
+    EXPECT_EQ(LEPTJSON_LITERAL("[ 1 , [ [ 2 ] ] , 3 ]").toJson(), parseOk("[ 1 , [ [ 2 ] ] , 3 ]"));
+    EXPECT_EQ(LEPTJSON_LITERAL("\"\"").toJson(), Json(""));
+
+    //运行时使用时语法错误抛出异常
+    EXPECT_THROW(detail::measureLiteral("[ 1 , ]"), JsonException);
+    EXPECT_THROW(detail::measureLiteral("{ \"a\" 1 }"), JsonException);
+    EXPECT_THROW(detail::measureLiteral("1e400"), JsonException);
+    EXPECT_THROW(root["missing"], JsonException);
+}
+
+TEST(Snapshot, RoundTrip) {
+    string errMsg;
+    ParseOptions options;
+    options.packNumbers = true;
+    Json json = Json::parse(R"({ "name" : "snap\u0000shot", "list" : [true, null, {"k" : "v"}, []],
+                                 "nums" : [1, 2.5, -3], "ids" : [7, 8, 9], "empty" : {} })", errMsg, options);
+    ASSERT_EQ(errMsg, "");
+    string bytes = Snapshot::build(json);
+    //按8字节对齐的副本
+    vector<uint64_t> buffer((bytes.size() + 7) / 8);
+    memcpy(buffer.data(), bytes.data(), bytes.size());
+
+    auto snapshot = Snapshot::fromBuffer(buffer.data(), bytes.size(), errMsg, true);
+    ASSERT_TRUE(snapshot);
+    SnapshotValue root = snapshot->root();
+    EXPECT_TRUE(root.isObject());
+    EXPECT_EQ(root.size(), 5);
+    EXPECT_EQ(root["name"].toString(), string("snap\0shot", 9));
+    EXPECT_TRUE(root["list"][0].toBool());
+    EXPECT_TRUE(root["list"][1].isNull());
+    EXPECT_EQ(root["list"][2]["k"].toString(), "v");
+    EXPECT_EQ(root["nums"][1].toNumber(), 2.5);
+    EXPECT_EQ(root["ids"][2].toNumber(), 9);
+    EXPECT_EQ(root.key(0), "empty");
+    EXPECT_FALSE(root.contains("missing"));
+    EXPECT_THROW(root["missing"], JsonException);
+    EXPECT_THROW(root["list"][4], JsonException);
+    EXPECT_EQ(root.toJson(), json);
+    EXPECT_EQ(Snapshot::fromBuffer(buffer.data(), bytes.size(), errMsg)->root()["list"].toJson(), json["list"]);
+
+    //rawNumbers解析出的数字保留原文
+    ParseOptions raw;
+    raw.rawNumbers = true;
+    Json big = Json::parse("[12345678901234567890123, 1.50, 7]", errMsg, raw);
+    string rawBytes = Snapshot::build(big);
+    vector<uint64_t> rawBuffer((rawBytes.size() + 7) / 8);
+    memcpy(rawBuffer.data(), rawBytes.data(), rawBytes.size());
+    Json restored = Snapshot::fromBuffer(rawBuffer.data(), rawBytes.size(), errMsg)->root().toJson();
+    ASSERT_TRUE(restored[0].rawNumber());
+    EXPECT_EQ(*restored[0].rawNumber(), "12345678901234567890123");
+    EXPECT_EQ(restored.serialize(), big.serialize());
+    EXPECT_FALSE(root["nums"].toJson()[0].rawNumber());
+
+    //文件的保存和映射
+    string path = "snapshot_test.bin";
+    EXPECT_TRUE(Snapshot::save(json, path, errMsg));
+    auto mapped = Snapshot::open(path, errMsg, true);
+    ASSERT_TRUE(mapped);
+    EXPECT_EQ(mapped->byteSize(), bytes.size());
+    EXPECT_EQ(mapped->root().toJson(), json);
+    mapped.reset();
+    std::remove(path.c_str());
+    EXPECT_FALSE(Snapshot::open(path, errMsg));
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "CANNOT OPEN");
+
+    //子节点指回祖先形成环，或者元素个数超出子节点表，转换时报错而不是死循环或者预留过大的空间
+    {
+        string nested = Snapshot::build(parseOk("[[1]]"));
+        vector<uint64_t> words((nested.size() + 7) / 8);
+        memcpy(words.data(), nested.data(), nested.size());
+        SnapshotNode* nodes = reinterpret_cast<SnapshotNode*>(reinterpret_cast<char*>(words.data()) + sizeof(SnapshotHeader));
+        uint64_t* children = reinterpret_cast<uint64_t*>(nodes + 3);
+        children[nodes[1].b] = 0;
+        auto cyclic = Snapshot::fromBuffer(words.data(), nested.size(), errMsg);
+        ASSERT_TRUE(cyclic);
+        EXPECT_THROW(cyclic->root().toJson(), JsonException);
+        children[nodes[1].b] = 2;
+        nodes[1].a = uint64_t(1) << 60;
+        EXPECT_THROW(cyclic->root().toJson(), JsonException);
+        nodes[1].a = 1;
+        EXPECT_EQ(cyclic->root().toJson(), parseOk("[[1]]"));
+    }
+
+    //损坏的数据
+    reinterpret_cast<char*>(buffer.data())[bytes.size() - 1] ^= 1;
+    EXPECT_FALSE(Snapshot::fromBuffer(buffer.data(), bytes.size(), errMsg, true));
+    EXPECT_EQ(errMsg, "CHECKSUM MISMATCH");
+    EXPECT_FALSE(Snapshot::fromBuffer(buffer.data(), bytes.size() - 1, errMsg));
+    EXPECT_EQ(errMsg, "CORRUPT SNAPSHOT");
+    reinterpret_cast<char*>(buffer.data())[0] = 'X';
+    EXPECT_FALSE(Snapshot::fromBuffer(buffer.data(), bytes.size(), errMsg));
+    EXPECT_EQ(errMsg, "NOT A SNAPSHOT");
+}
+
+//每次只给出chunk个字节，让所有token都有机会跨过缓冲区边界
+Json parseInChunks(const string& text, size_t chunk, string& errMsg, const ParseOptions& options = ParseOptions()) {
+    size_t pos = 0;
+    return parseChunked([&](char* dest, size_t capacity) {
+        size_t n = min({chunk, capacity, text.size() - pos});
+        memcpy(dest, text.data() + pos, n);
+        pos += n;
+        return n;
+    }, errMsg, options);
+}
+
+TEST(Parse, Chunked) {
+    string text = R"( { "name" : "café 𝄞 é𝄞" , "n" : [-1.25e-3, 12345678901234567890123456789012345678901234567890123456789012345678901234567890, 0],
+                       "skip" : { "a" : ["x\"y", 1e5, {}] , "b" : "long )" + string(300, 'z') + R"(" } , "t" : [true, false, null] } )";
+    string errMsg;
+    Json expect = parseOk(text);
+    for (size_t chunk : {1, 2, 3, 5, 7, 64, 100000}) {
+        EXPECT_EQ(parseInChunks(text, chunk, errMsg), expect) << chunk;
+        EXPECT_EQ(errMsg, "");
+    }
+
+    //多字节序列被切断时严格校验也不误报
+    ParseOptions options;
+    options.strictUtf8 = true;
+    options.fields = {"name", "t"};
+    for (size_t chunk : {1, 2, 3}) {
+        Json json = parseInChunks(text, chunk, errMsg, options);
+        EXPECT_EQ(errMsg, "");
+        EXPECT_EQ(json["name"].toString(), "café 𝄞 é𝄞");
+        EXPECT_FALSE(json.toObject().count("skip"));
+    }
+
+    parseInChunks("[1, \"abc", 2, errMsg);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS QUOTATION MARK");
+    parseInChunks("[1, 2] x", 3, errMsg);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "ROOT NOT SINGULAR");
+}
+
+#ifdef LEPTJSON_HAVE_ZLIB
+string gzipCompress(const string& text) {
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    string res(deflateBound(&zs, text.size()), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    zs.avail_in = text.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&res[0]);
+    zs.avail_out = res.size();
+    deflate(&zs, Z_FINISH);
+    res.resize(zs.total_out);
+    deflateEnd(&zs);
+    return res;
+}
+
+TEST(Parse, Gzip) {
+    string text = "[";
+    for (int i = 0; i < 20000; i++)
+        text += "{\"id\" : " + to_string(i) + ", \"tag\" : \"item" + to_string(i % 7) + "\"},";
+    text += "null]";
+    Json expect = parseOk(text);
+    string gz = gzipCompress(text);
+    string errMsg;
+    //块很小，解压线程经常要等解析线程
+    GzipOptions small;
+    small.slots = 2;
+    small.slotSize = 4096;
+    EXPECT_EQ(parseGzip(gz.data(), gz.size(), errMsg, ParseOptions(), small), expect);
+    EXPECT_EQ(errMsg, "");
+
+    //拼接的两个成员
+    string twoMembers = gzipCompress("[1, 2,") + gzipCompress(" 3]");
+    EXPECT_EQ(parseGzip(twoMembers.data(), twoMembers.size(), errMsg), parseOk("[1, 2, 3]"));
+
+    string path = "gzip_test.json.gz";
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(gz.data(), 1, gz.size(), file);
+    fclose(file);
+    EXPECT_EQ(parseGzipFile(path, errMsg), expect);
+    EXPECT_EQ(errMsg, "");
+    std::remove(path.c_str());
+
+    parseGzip(gz.data(), gz.size() / 2, errMsg);
+    EXPECT_EQ(errMsg, "INVALID GZIP: TRUNCATED");
+    string corrupt = gz;
+    corrupt[corrupt.size() / 2] ^= 0x55;
+    corrupt[corrupt.size() / 2 + 1] ^= 0x55;
+    parseGzip(corrupt.data(), corrupt.size(), errMsg);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "INVALID GZIP");
+    //解析提前失败时解压线程也能停下
+    string bad = gzipCompress("[1, x" + string(1 << 20, ' ') + "]");
+    parseGzip(bad.data(), bad.size(), errMsg, ParseOptions(), small);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "INVALID VALUE");
+    parseGzipFile("missing.json.gz", errMsg);
+    EXPECT_EQ(errMsg, "CANNOT OPEN: missing.json.gz");
+}
+#endif
+
+TEST(Columns, Extract) {
+    string text = R"([ {"id" : 1, "price" : 10, "name" : "a", "ok" : true, "tags" : [], "mixed" : "s"},
+                       {"name" : "bé", "id" : 2, "price" : null, "ok" : false, "mixed" : 1},
+                       {"id" : 3, "price" : 2.5, "extra" : "skipped", "mixed" : "x"},
+                       {"id" : 4, "name" : "dup", "price" : 7} ])";
+    ColumnOptions options;
+    options.inferRows = 2;
+    ColumnTable parsed, loaded;
+    string errMsg;
+    ASSERT_TRUE(parsed.parse(text, errMsg, options)) << errMsg;
+    ASSERT_TRUE(loaded.load(parseOk(text), errMsg, options)) << errMsg;
+    for (const ColumnTable* table : {&parsed, &loaded}) {
+        EXPECT_EQ(table->rows(), 4);
+        EXPECT_EQ(table->columns().size(), 4);
+        EXPECT_FALSE(table->column("tags"));
+        EXPECT_FALSE(table->column("mixed"));
+        EXPECT_FALSE(table->column("extra"));
+
+        const Column* id = table->column("id");
+        ASSERT_TRUE(id);
+        EXPECT_EQ(id->type, ColumnType::kInt);
+        EXPECT_EQ(id->ints, vector<int64_t>({1, 2, 3, 4}));
+
+        //推断时只见过整数，第三条记录把整列转成小数
+        const Column* price = table->column("price");
+        EXPECT_EQ(price->type, ColumnType::kDouble);
+        EXPECT_EQ(price->doubles, vector<double>({10, 0, 2.5, 7}));
+        EXPECT_TRUE(price->isValid(0));
+        EXPECT_FALSE(price->isValid(1));
+
+        const Column* name = table->column("name");
+        EXPECT_EQ(name->type, ColumnType::kString);
+        EXPECT_EQ(name->stringAt(1), "bé");
+        EXPECT_FALSE(name->isValid(2));
+        EXPECT_EQ(name->stringAt(2), "");
+        EXPECT_EQ(name->stringAt(3), "dup");
+        EXPECT_EQ(name->bytes, "abédup");
+
+        const Column* ok = table->column("ok");
+        EXPECT_EQ(ok->type, ColumnType::kBool);
+        EXPECT_EQ(ok->bools, vector<uint8_t>({1, 0, 0, 0}));
+        EXPECT_EQ(ok->validity[0], 3u);
+    }
+
+    //超过64行时validity跨越多个字
+    string many = "[";
+    for (int i = 0; i < 130; i++)
+        many += string(i ? "," : "") + (i % 3 ? "{\"v\" : " + to_string(i) + "}" : "{}");
+    many += "]";
+    ASSERT_TRUE(parsed.parse(many, errMsg));
+    EXPECT_EQ(parsed.column("v")->validity.size(), 3);
+    EXPECT_TRUE(parsed.column("v")->isValid(128));
+    EXPECT_FALSE(parsed.column("v")->isValid(129));
+    EXPECT_EQ(parsed.column("v")->ints[128], 128);
+
+    EXPECT_FALSE(parsed.parse(R"([{"a" : 1}, {"a" : 2}, {"a" : "x"}])", errMsg, options));
+    EXPECT_EQ(errMsg, "COLUMN TYPE MISMATCH: a");
+    EXPECT_EQ(parsed.rows(), 0);
+    EXPECT_FALSE(parsed.parse(R"([{"a" : 1}, {"a" : 2}, 3])", errMsg, options));
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "EXPECT OBJECT");
+    EXPECT_FALSE(loaded.load(parseOk("{}"), errMsg));
+    EXPECT_EQ(errMsg, "EXPECT ARRAY");
+    EXPECT_TRUE(parsed.parse("[]", errMsg));
+    EXPECT_EQ(parsed.rows(), 0);
+
+    //inferRows为0时load()和parse()都用第一条记录推断
+    ColumnOptions none;
+    none.inferRows = 0;
+    string sparse = R"([{"id" : 1}, {"id" : 2, "late" : true}])";
+    ASSERT_TRUE(parsed.parse(sparse, errMsg, none)) << errMsg;
+    ASSERT_TRUE(loaded.load(parseOk(sparse), errMsg, none)) << errMsg;
+    for (const ColumnTable* table : {&parsed, &loaded}) {
+        EXPECT_EQ(table->rows(), 2);
+        EXPECT_EQ(table->columns().size(), 1);
+        EXPECT_EQ(table->column("id")->ints, vector<int64_t>({1, 2}));
+        EXPECT_FALSE(table->column("late"));
+    }
+}
+
+vector<Json> selectAll(const Json& root, const string& expression, const PathOptions& options = PathOptions()) {
+    vector<Json> res;
+    for (const Json* json : JsonPath(expression).select(root, options))
+        res.push_back(*json);
+    return res;
+}
+
+TEST(Path, Select) {
+    Json root = parseOk(R"({ "store" : { "items" : [
+        { "id" : 1, "price" : 8.5, "tags" : ["a"] },
+        { "id" : 2, "price" : 12, "name" : "pen" },
+        { "id" : 3, "price" : 30, "name" : "ink", "sale" : true } ],
+        "owner" : { "name" : "bob" } }, "limit" : 10 })");
+    EXPECT_EQ(selectAll(root, "$.store.items[?(@.price > 10)].id"), vector<Json>({Json(2), Json(3)}));
+    EXPECT_EQ(selectAll(root, "$['store'].items[-1].name"), vector<Json>({Json("ink")}));
+    EXPECT_EQ(selectAll(root, "$.store.items[0:2].id"), vector<Json>({Json(1), Json(2)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[::-2].id"), vector<Json>({Json(3), Json(1)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[0:10:9223372036854775807].id"), vector<Json>({Json(1)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[2:-10:-9223372036854775808].id"), vector<Json>({Json(3)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[*].tags[0]"), vector<Json>({Json("a")}));
+    EXPECT_EQ(selectAll(root, "$.store.items[2,0].id"), vector<Json>({Json(3), Json(1)}));
+    EXPECT_EQ(selectAll(root, "$..items[?@.sale].id"), vector<Json>({Json(3)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[?(@.price >= $.limit && !(@.name == 'ink'))].id"), vector<Json>({Json(2)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[?(@.name != \"pen\" || @.id < 1)].id"), vector<Json>({Json(1), Json(3)}));
+    //两边都不存在时相等
+    EXPECT_EQ(selectAll(root, "$.store.items[?(@.name == @.missing)].id"), vector<Json>({Json(1)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[?(@.tags[0] == 'a')].id"), vector<Json>({Json(1)}));
+    EXPECT_EQ(selectAll(root, "$.store.items[5]"), vector<Json>());
+    EXPECT_EQ(selectAll(root, "$").size(), 1);
+
+    //递归下降按文档顺序
+    vector<Json> names = selectAll(root, "$..name");
+    EXPECT_EQ(names.size(), 3);
+    EXPECT_EQ(JsonPath("$..*").select(root).size(), 19);
+
+    //返回的是原节点
+    EXPECT_EQ(JsonPath("$.store.owner").select(root)[0], &root["store"]["owner"]);
+
+    for (const char* bad : {"store", "$.", "$[", "$[1", "$[?(@.a ==)]", "$['a]", "$.a[?(1)]", "$[?(@.*)]"})
+        EXPECT_THROW(JsonPath{bad}, JsonException) << bad;
+}
+
+TEST(Path, Parallel) {
+    Json::_array arr;
+    for (int i = 0; i < 10000; i++)
+        arr.push_back(Json(Json::_object{{"v", Json(i % 100)}, {"i", Json(i)}}));
+    Json root{Json::_object{{"rows", Json(std::move(arr))}}};
+    JsonPath path("$.rows[?(@.v == 42)].i");
+    PathOptions options;
+    options.threads = 4;
+    options.parallelThreshold = 1000;
+    vector<const Json*> serial = path.select(root);
+    vector<const Json*> parallel = path.select(root, options);
+    EXPECT_EQ(serial.size(), 100);
+    EXPECT_EQ(serial, parallel);
+}
+
+TEST(Bind, FromJson) {
+    Shape shape;
+    string errMsg;
+    EXPECT_TRUE(fromJson(
+        R"({ "name" : "tri\nangle", "shape_id" : 7, "unknown" : { "k" : [1, 2] },
+             "visible" : true, "points" : [ {"x" : 1, "y" : 2}, {"y" : 4, "x" : 3} ],
+             "extra" : [null] })",
+        shape, errMsg));
+    EXPECT_EQ(errMsg, "");
+    EXPECT_EQ(shape.name, "tri\nangle");
+    EXPECT_EQ(shape.id, 7);
+    EXPECT_TRUE(shape.visible);
+    ASSERT_EQ(shape.points.size(), 2);
+    EXPECT_EQ(shape.points[1].x, 3);
+    EXPECT_EQ(shape.points[1].y, 4);
+    EXPECT_TRUE(shape.extra.isArray());
+
+    Point p;
+    EXPECT_FALSE(fromJson("{\"x\" : 1", p, errMsg));
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "MISS COMMA OR CURLY BRACKET");
+    EXPECT_FALSE(fromJson("{\"x\" : true}", p, errMsg));
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "EXPECT NUMBER");
+
+    //整数字段检查小数和范围，报错时给出字段名
+    Counter counter;
+    EXPECT_TRUE(fromJson(R"({ "small" : 255, "big" : [-9223372036854775808] })", counter, errMsg));
+    EXPECT_EQ(counter.small, 255);
+    EXPECT_EQ(counter.big[0], INT64_MIN);
+    EXPECT_FALSE(fromJson(R"({ "small" : 256 })", counter, errMsg));
+    EXPECT_EQ(errMsg, "INTEGER OUT OF RANGE: small");
+    EXPECT_FALSE(fromJson(R"({ "small" : -1 })", counter, errMsg));
+    EXPECT_EQ(errMsg, "INTEGER OUT OF RANGE: small");
+    EXPECT_FALSE(fromJson(R"({ "small" : 1.5 })", counter, errMsg));
+    EXPECT_EQ(errMsg, "EXPECT INTEGER: small");
+    EXPECT_FALSE(fromJson(R"({ "big" : [1, 9223372036854775808] })", counter, errMsg));
+    EXPECT_EQ(errMsg, "INTEGER OUT OF RANGE: big");
+}
+
+TEST(Bind, ToJson) {
+    Shape shape;
+    shape.name = "line";
+    shape.id = 3;
+    shape.points = {{1.5, 2}, {0, -1}};
+    string text = toJson(shape);
+    EXPECT_EQ(text,
+              R"({"name":"line","shape_id":3,"visible":false,)"
+              R"("points":[{"x":1.5,"y":2},{"x":0,"y":-1}],"extra":null})");
+
+    Shape back;
+    string errMsg;
+    EXPECT_TRUE(fromJson(text, back, errMsg));
+    EXPECT_EQ(toJson(back), text);
+    EXPECT_EQ(parseOk(text)["points"][0]["x"].toNumber(), 1.5);
+
+    //key里的引号要转义
+    Counter counter;
+    counter.quoted = 2;
+    text = toJson(counter);
+    EXPECT_EQ(text, R"({"small":0,"big":[],"say \"hi\"":2})");
+    Counter counterBack;
+    EXPECT_TRUE(fromJson(text, counterBack, errMsg));
+    EXPECT_EQ(counterBack.quoted, 2);
+
+    //vector<bool>、char写成单个字符的字符串、signed char按整数处理
+    Flags flags;
+    flags.bits = {true, false, true};
+    flags.grade = '"';
+    flags.delta = -3;
+    flags.ratio = 0.5;
+    text = toJson(flags);
+    EXPECT_EQ(text, R"({"bits":[true,false,true],"grade":"\"","delta":-3,"ratio":0.5})");
+    Flags flagsBack;
+    EXPECT_TRUE(fromJson(text, flagsBack, errMsg));
+    EXPECT_EQ(flagsBack.bits, flags.bits);
+    EXPECT_EQ(flagsBack.grade, '"');
+    EXPECT_EQ(flagsBack.delta, -3);
+    EXPECT_FALSE(fromJson(R"({"grade" : "ab"})", flagsBack, errMsg));
+    EXPECT_EQ(errMsg, "EXPECT ONE CHARACTER: grade");
+
+    //NaN和无穷不能写成JSON
+    flags.ratio = INFINITY;
+    EXPECT_THROW(toJson(flags), JsonException);
+    flags.ratio = NAN;
+    EXPECT_THROW(toJson(flags), JsonException);
+}
+
+#define testSchemaError(expect, schema, strJson)             \
+    do {                                                     \
+        string errMsg;                                       \
+        Json json = schema.parse(strJson, errMsg);           \
+        EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), expect); \
+        string treeMsg;                                      \
+        EXPECT_FALSE(schema.validate(parseOk(strJson), treeMsg)); \
+        EXPECT_EQ(treeMsg, errMsg);                          \
+    } while (0)
+
+TEST(Schema, Validate) {
+    Schema schema(parseOk(R"({
+        "type" : "object",
+        "required" : ["id", "tags"],
+        "additionalProperties" : false,
+        "properties" : {
+            "id" : { "type" : "integer", "minimum" : 1 },
+            "name" : { "type" : "string", "minLength" : 2, "pattern" : "^[a-z]+$" },
+            "tags" : { "type" : "array", "maxItems" : 2, "items" : { "enum" : ["a", "b", 3] } },
+            "score" : { "type" : ["number", "null"], "exclusiveMaximum" : 10 },
+            "extra" : true
+        }
+    })"));
+
+    string ok = R"({ "id" : 3, "name" : "abc", "tags" : ["a", 3], "score" : null, "extra" : [{}] })";
+    string errMsg;
+    EXPECT_TRUE(schema.validate(parseOk(ok), errMsg));
+    Json json = schema.parse(ok, errMsg);
+    EXPECT_EQ(errMsg, "");
+    EXPECT_EQ(json, parseOk(ok));
+
+    testSchemaError("TYPE MISMATCH", schema, "[]");
+    testSchemaError("TYPE MISMATCH", schema, R"({ "id" : 1.5, "tags" : [] })");
+    testSchemaError("NUMBER OUT OF RANGE", schema, R"({ "id" : 0, "tags" : [] })");
+    testSchemaError("NUMBER OUT OF RANGE", schema, R"({ "id" : 1, "tags" : [], "score" : 10 })");
+    testSchemaError("MISS REQUIRED", schema, R"({ "id" : 1 })");
+    testSchemaError("STRING LENGTH OUT OF RANGE", schema, R"({ "id" : 1, "tags" : [], "name" : "a" })");
+    testSchemaError("PATTERN MISMATCH", schema, R"({ "id" : 1, "tags" : [], "name" : "A1" })");
+    testSchemaError("NOT IN ENUM", schema, R"({ "id" : 1, "tags" : ["c"] })");
+    testSchemaError("ARRAY SIZE OUT OF RANGE", schema, R"({ "id" : 1, "tags" : ["a", "a", "a"] })");
+    testSchemaError("ADDITIONAL PROPERTY", schema, R"({ "id" : 1, "tags" : [], "other" : 1 })");
+
+    schema.validate(parseOk(R"({ "id" : 1, "tags" : ["a", "x"] })"), errMsg);
+    EXPECT_EQ(errMsg, "NOT IN ENUM: /tags/1");
+
+    schema.parse(R"({ "id" : 1, "tags" : [1, )", errMsg);
+    EXPECT_EQ(errMsg.substr(0, errMsg.find(':')), "NOT IN ENUM");
+
+    //同时给出包含和不包含的边界时两个都要满足，和key的顺序无关
+    for (string bounds : {R"({ "minimum" : 0, "exclusiveMinimum" : 5, "maximum" : 10, "exclusiveMaximum" : 8 })",
+                          R"({ "exclusiveMaximum" : 8, "maximum" : 10, "exclusiveMinimum" : 5, "minimum" : 0 })"}) {
+        Schema range(parseOk(bounds));
+        EXPECT_TRUE(range.validate(Json(6), errMsg));
+        EXPECT_FALSE(range.validate(Json(3), errMsg));
+        EXPECT_FALSE(range.validate(Json(5), errMsg));
+        EXPECT_FALSE(range.validate(Json(9), errMsg));
+        EXPECT_FALSE(range.validate(Json(8), errMsg));
+    }
+
+    //错误位置中的key按RFC 6901转义
+    Schema escaped(parseOk(R"({ "required" : ["a/b~c"], "properties" : { "x/y" : { "type" : "string" } } })"));
+    EXPECT_FALSE(escaped.validate(parseOk("{}"), errMsg));
+    EXPECT_EQ(errMsg, "MISS REQUIRED: /a~1b~0c");
+    EXPECT_FALSE(escaped.validate(parseOk(R"({ "a/b~c" : 1, "x/y" : 2 })"), errMsg));
+    EXPECT_EQ(errMsg, "TYPE MISMATCH: /x~1y");
+    escaped.parse(R"({ "a/b~c" : 1, "x/y" : 2 })", errMsg);
+    EXPECT_EQ(errMsg, "TYPE MISMATCH: /x~1y");
+
+    EXPECT_THROW(Schema(parseOk(R"({ "type" : "float" })")), JsonException);
+    EXPECT_THROW(Schema(parseOk(R"({ "minLength" : -1 })")), JsonException);
+}
+
+TEST(Json, MemoryUsage) {
+    Json json = parseOk(R"({ "short" : "abc", "long" : "a string that does not fit in SSO",
+                             "list" : [1, 2, null] })");
+    MemoryUsage usage = json.memoryUsage();
+    EXPECT_EQ(usage.nodes, 7);
+    EXPECT_EQ(usage.strings, 2);
+    EXPECT_EQ(usage.arrays, 1);
+    EXPECT_EQ(usage.objects, 1);
+    EXPECT_GT(usage.stringBytes, string("a string that does not fit in SSO").size());
+    EXPECT_GE(usage.containerBytes, 3 * sizeof(Json));
+    EXPECT_EQ(usage.totalBytes(), usage.nodeBytes + usage.stringBytes + usage.containerBytes);
+
+    //共享的子树只统计一次
+    Json twice = Json::_array{json, json};
+    EXPECT_EQ(twice.memoryUsage().nodes, usage.nodes + 1);
+}
+
+TEST(Json, MemoryResource) {
+    CountingResource counting;
+    string content = R"({ "list" : [1, 2, 3], "name" : "lept", "nested" : { "flag" : true } })";
+    {
+        ParseOptions options;
+        options.resource = &counting;
+        string errMsg;
+        Json json = Json::parse(content, errMsg, options);
+        EXPECT_EQ(errMsg, "");
+        EXPECT_EQ(json, parseOk(content));
+        //9个节点，外加两个对象的哈希表和一个数组的缓冲区
+        EXPECT_GE(counting.allocations(), 9 + 3);
+        EXPECT_GT(counting.bytesInUse(), 0);
+
+        //写时复制出来的节点和容器仍然分配在resource上
+        size_t allocations = counting.allocations();
+        Json copy = json;
+        copy["list"][0] = Json(10);
+        EXPECT_EQ(json["list"][0].toNumber(), 1);
+        EXPECT_GE(counting.allocations(), allocations + 4);
+        Json nested = copy["nested"];
+        allocations = counting.allocations();
+        Json again = copy;
+        EXPECT_GE(counting.allocations(), allocations + 2);
+    }
+    EXPECT_EQ(counting.bytesInUse(), 0);
+    EXPECT_EQ(counting.allocations(), counting.deallocations());
+
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource pool(&upstream);
+    {
+        Json json(Json::_array{Json(1, &pool), Json("str", &pool)}, &pool);
+        EXPECT_EQ(json.size(), 2);
+        EXPECT_EQ(json[1].toString(), "str");
+    }
+    EXPECT_GT(upstream.allocations(), 0);
+    EXPECT_EQ(upstream.deallocations(), 0);
+}
+
+TEST(ParseCache, SharedDocument) {
+    ParseCache cache(4, 2);
+    string errMsg;
+    auto first = cache.parse("{\"flag\" : true}", errMsg);
+    auto second = cache.parse("{\"flag\" : true}", errMsg);
+    EXPECT_EQ(errMsg, "");
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+
+    EXPECT_EQ(cache.parse("[1,", errMsg), nullptr);
+    EXPECT_NE(errMsg, "");
+
+    for (int i = 0; i < 10; i++) cache.parse(to_string(i), errMsg);
+    EXPECT_LE(cache.size(), 4);
+
+    Json copy = *first;
+    copy["flag"] = Json(false);
+    EXPECT_TRUE((*first)["flag"].toBool());
+
+    //分片数多于容量时总数也不超过容量
+    ParseCache single(1, 16);
+    for (int i = 0; i < 32; i++) single.parse(to_string(i), errMsg);
+    EXPECT_EQ(single.size(), 1);
+    ParseCache uneven(10, 4);
+    for (int i = 0; i < 200; i++) uneven.parse(to_string(i), errMsg);
+    EXPECT_EQ(uneven.size(), 10);
+    ParseCache none(0);
+    none.parse("[]", errMsg);
+    EXPECT_EQ(none.size(), 0);
+}
+
+TEST(ParseCache, ConcurrentReaders) {
+    ParseCache cache;
+    vector<thread> workers;
+    vector<int> ok(4, 0);
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&cache, &ok, t] {
+            for (int i = 0; i < 200; i++) {
+                string errMsg;
+                auto doc = cache.parse("{\"list\" : [1, 2, 3]}", errMsg);
+                Json copy = *doc;
+                copy["list"][0] = Json(t);
+                if ((*doc)["list"][0].toNumber() == 1 && copy["list"][0].toNumber() == t)
+                    ok[t]++;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    for (int n : ok) EXPECT_EQ(n, 200);
+}
+
 void my_test()
 {
     string origin = "[true, null, 3.14, \"hello world\", [0], {\"a\" : 1}]";